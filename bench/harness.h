@@ -0,0 +1,94 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+// Minimal self-contained microbenchmark harness. Each benchmark body runs a batch of iterations;
+// the batch size is doubled until one batch takes at least MIN_BATCH_MS, then REPETITIONS batches are
+// timed and the median, min and max time per iteration are reported. Results print as a table and can
+// be written as JSON for diffing between commits.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// keeps `value` alive as far as the optimiser can tell
+template<typename T>
+inline void DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    unsigned long long iterations;
+    double nsPerOp;
+    double minNs;
+    double maxNs;
+    // work items per iteration, e.g. vertices converted; 0 when it is not meaningful
+    double itemsPerOp;
+};
+
+class Runner {
+public:
+    static constexpr double MIN_BATCH_MS = 20.0;
+    static constexpr int REPETITIONS = 7;
+
+    explicit Runner(std::string filter = "") : filter(std::move(filter)) {}
+
+    // body(iterations) must do `iterations` units of work
+    void Run(const std::string &name, double itemsPerOp, const std::function<void(unsigned long long)> &body) {
+        if(!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+
+        unsigned long long iterations = 1;
+        while(time(body, iterations) < MIN_BATCH_MS * 1e6 && iterations < (1ULL << 40))
+            iterations *= 2;
+
+        std::vector<double> samples;
+        for(int i = 0; i < REPETITIONS; i++)
+            samples.push_back(time(body, iterations) / iterations);
+        std::sort(samples.begin(), samples.end());
+
+        Result result{name, iterations, samples[samples.size() / 2], samples.front(), samples.back(), itemsPerOp};
+        std::printf("%-40s %14.1f ns/op %12.1f min %12.1f max", name.c_str(), result.nsPerOp, result.minNs, result.maxNs);
+        if(itemsPerOp > 0.0)
+            std::printf(" %10.2f M items/s", itemsPerOp / result.nsPerOp * 1e3);
+        std::printf("\n");
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+
+    bool WriteJson(const std::string &path) const {
+        std::ofstream file(path, std::ios::trunc);
+        file << "{\n  \"benchmarks\": [\n";
+        for(auto i = 0U; i < results.size(); i++) {
+            auto &result = results[i];
+            file << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+                 << ", \"ns_per_op\": " << result.nsPerOp << ", \"min_ns\": " << result.minNs << ", \"max_ns\": " << result.maxNs;
+            if(result.itemsPerOp > 0.0)
+                file << ", \"items_per_second\": " << result.itemsPerOp / result.nsPerOp * 1e9;
+            file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    const std::vector<Result> &Results() const { return results; }
+
+private:
+    static double time(const std::function<void(unsigned long long)> &body, unsigned long long iterations) {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string filter;
+    std::vector<Result> results;
+};
+
+}
+
+#endif
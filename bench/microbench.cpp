@@ -0,0 +1,328 @@
+// Microbenchmarks for the CPU side of startup and the frame loop. GL calls go to a null layer, so this
+// runs headless and measures only the engine's own work.
+// usage: MicroBench [filter] [--json file]
+#include <assimp/scene.h>
+#include <assimp/material.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "nullgl.h"
+#include "fieldgenerator.h"
+#include "jobsystem.h"
+#include "bvh.h"
+#include "picking.h"
+#include "camera.h"
+#include "model.h"
+#include "shader.h"
+
+// Model links against the viewer's texture loader; hand out ids without touching the disk
+unsigned int TextureFromFile(const char *, const std::string &, bool) {
+    static unsigned int id = 0;
+    return ++id;
+}
+
+// (n + 1) x (n + 1) vertex grid with 2 * n * n triangles, in the layout aiProcess_Triangulate produces
+static void fillGridMesh(aiMesh &mesh, unsigned int n) {
+    unsigned int side = n + 1;
+    mesh.mNumVertices = side * side;
+    mesh.mVertices = new aiVector3D[mesh.mNumVertices];
+    mesh.mNormals = new aiVector3D[mesh.mNumVertices];
+    mesh.mTextureCoords[0] = new aiVector3D[mesh.mNumVertices];
+    mesh.mNumUVComponents[0] = 2;
+    for(auto z = 0U; z < side; z++) {
+        for(auto x = 0U; x < side; x++) {
+            auto i = z * side + x;
+            mesh.mVertices[i] = aiVector3D(x * 0.1f, 0.0f, z * 0.1f);
+            mesh.mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+            mesh.mTextureCoords[0][i] = aiVector3D(float(x) / n, float(z) / n, 0.0f);
+        }
+    }
+
+    mesh.mNumFaces = 2 * n * n;
+    mesh.mFaces = new aiFace[mesh.mNumFaces];
+    auto face = mesh.mFaces;
+    for(auto z = 0U; z < n; z++) {
+        for(auto x = 0U; x < n; x++) {
+            unsigned int a = z * side + x, b = a + 1, c = a + side, d = c + 1;
+            for(auto corners : {std::initializer_list<unsigned int>{a, c, b}, std::initializer_list<unsigned int>{b, c, d}}) {
+                face->mNumIndices = 3;
+                face->mIndices = new unsigned int[3];
+                std::copy(corners.begin(), corners.end(), face->mIndices);
+                face++;
+            }
+        }
+    }
+    mesh.mMaterialIndex = 0;
+}
+
+// A field has to come out bit-identical however it is split, or timings of different thread counts
+// compare different work. Checks a count that is no multiple of the batch size against one thread.
+static bool checkFieldDeterminism() {
+    const unsigned int count = 100003;
+    FieldGenerator generator(1337);
+    std::vector<glm::mat4> expected(count), matrices(count);
+    std::vector<glm::vec4> expectedBounds(count), bounds(count);
+    generator.Generate(expected.data(), count, 1, expectedBounds.data());
+
+    auto compare = [&](const std::string &how) {
+        if(std::memcmp(matrices.data(), expected.data(), count * sizeof(glm::mat4)) == 0 &&
+           std::memcmp(bounds.data(), expectedBounds.data(), count * sizeof(glm::vec4)) == 0)
+            return true;
+        std::cerr << "asteroids/generate: " << how << " differs from Generate(..., 1)" << std::endl;
+        return false;
+    };
+    for(unsigned int threads : {0U, 3U}) {
+        generator.Generate(matrices.data(), count, threads, bounds.data());
+        if(!compare("Generate(..., " + std::to_string(threads) + ")"))
+            return false;
+    }
+    // chunks that start and end in the middle of batches
+    for(unsigned int first = 0, chunk = 0; first < count; first += chunk) {
+        chunk = std::min(count - first, 777U + first % 61);
+        generator.GenerateRange(matrices.data() + first, first, chunk, count, bounds.data() + first);
+    }
+    return compare("GenerateRange chunks");
+}
+
+int main(int argc, char **argv) {
+    std::string filter, json;
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json = argv[++i];
+        else
+            filter = argv[i];
+    }
+
+    InstallNullGL();
+    bench::Runner runner(filter);
+
+    if(!checkFieldDeterminism())
+        return 1;
+    for(unsigned int count : {1000U, 100000U, 10000000U}) {
+        std::vector<glm::mat4> matrices(count);
+        for(unsigned int threads : {1U, 0U}) {
+            std::string name = "asteroids/generate/" + std::to_string(count) + (threads ? "/1thread" : "/all");
+            runner.Run(name, count, [&](unsigned long long iterations) {
+                for(auto i = 0ULL; i < iterations; i++) {
+                    FieldGenerator(static_cast<uint32_t>(i)).Generate(matrices.data(), count, threads);
+                    bench::DoNotOptimize(matrices[count - 1]);
+                }
+            });
+        }
+    }
+
+    // scheduler overhead and scaling, oversubscribing on purpose past the core count
+    for(unsigned int threads : {1U, 2U, 4U, 8U, 16U, 32U, 64U}) {
+        JobSystem jobs(threads);
+        std::string suffix = "/" + std::to_string(threads) + "threads";
+        const unsigned int JOBS = 1000;
+        runner.Run("jobs/run-wait" + suffix, JOBS, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                JobCounter counter;
+                for(auto j = 0U; j < JOBS; j++)
+                    jobs.Run([]{}, &counter);
+                jobs.Wait(counter);
+            }
+        });
+        // 64 independent chains of 16 jobs each
+        JobGraph graph;
+        for(auto chain = 0U; chain < 64; chain++) {
+            JobGraph::Node previous = graph.Add([]{});
+            for(auto link = 1U; link < 16; link++) {
+                JobGraph::Node next = graph.Add([]{});
+                graph.Precede(previous, next);
+                previous = next;
+            }
+        }
+        runner.Run("jobs/graph" + suffix, double(graph.Size()), [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                graph.Run(jobs);
+        });
+        std::vector<float> values(1 << 20, 2.0f);
+        for(size_t grain : {size_t(256), size_t(16384)}) {
+            runner.Run("jobs/parallel_for/grain" + std::to_string(grain) + suffix, double(values.size()), [&](unsigned long long iterations) {
+                for(auto i = 0ULL; i < iterations; i++) {
+                    jobs.ParallelFor(values.size(), grain, [&](size_t begin, size_t end) {
+                        for(auto k = begin; k < end; k++)
+                            values[k] = std::sqrt(values[k] * values[k] + 1.0f);
+                    });
+                    bench::DoNotOptimize(values[0]);
+                }
+            });
+        }
+    }
+
+    for(unsigned int count : {100000U, 10000000U}) {
+        // the viewer's ring, with bounds for a unit-radius rock
+        std::vector<glm::mat4> matrices(count);
+        std::vector<glm::vec4> spheres(count);
+        FieldGenerator(1337).Generate(matrices.data(), count, 0, spheres.data());
+        std::string suffix = "/" + std::to_string(count);
+
+        BVH bvh;
+        runner.Run("bvh/build" + suffix, count, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                bvh.Build(spheres.data(), count);
+        });
+        runner.Run("bvh/refit" + suffix, count, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                bvh.Refit(spheres.data());
+        });
+        // one asteroid in a thousand nudged, as a small per-frame update would
+        std::vector<uint32_t> moved;
+        for(auto i = 0U; i < count; i += 1000)
+            moved.push_back(i);
+        runner.Run("bvh/refit-incremental" + suffix, double(moved.size()), [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                for(auto id : moved)
+                    spheres[id].y += (i & 1) ? -0.01f : 0.01f;
+                bvh.Refit(spheres.data(), moved);
+            }
+        });
+
+        std::vector<uint32_t> ids;
+        std::vector<RayHit> hits;
+        // the benchmark camera's view from outside the ring, looking across it
+        glm::mat4 view = glm::lookAt(glm::vec3(80.0f, 12.0f, 0.0f), glm::vec3(0.0f, -3.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::FromMatrix(glm::perspective(glm::radians(45.0f), 1366.0f / 768.0f, 0.1f, 10000.0f) * view);
+        runner.Run("bvh/frustum" + suffix, count, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                ids.clear();
+                bvh.QueryFrustum(frustum, ids);
+                bench::DoNotOptimize(ids.data());
+            }
+        });
+        runner.Run("bvh/sphere" + suffix, 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                ids.clear();
+                bvh.QuerySphere(glm::vec3(50.0f, 0.0f, 0.0f), 2.0f, ids);
+                bench::DoNotOptimize(ids.data());
+            }
+        });
+        runner.Run("bvh/ray" + suffix, 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                hits.clear();
+                bvh.QueryRay(glm::vec3(80.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), 1000.0f, hits);
+                bench::DoNotOptimize(hits.data());
+            }
+        });
+    }
+
+    {
+        aiScene scene;
+        scene.mNumMaterials = 1;
+        scene.mMaterials = new aiMaterial *[1]{new aiMaterial()};
+        aiMesh mesh;
+        fillGridMesh(mesh, 100);
+        Model model;
+        runner.Run("model/processMesh/" + std::to_string(mesh.mNumVertices), mesh.mNumVertices, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                Mesh result = model.processMesh(&mesh, &scene);
+                bench::DoNotOptimize(result.VAO);
+            }
+        });
+    }
+
+    {
+        // picking through a 1M ring with the 20x20 grid standing in for the rock
+        aiScene scene;
+        scene.mNumMaterials = 1;
+        scene.mMaterials = new aiMaterial *[1]{new aiMaterial()};
+        aiMesh grid;
+        fillGridMesh(grid, 20);
+        Model model;
+        model.meshes.push_back(model.processMesh(&grid, &scene));
+        MeshRaycaster raycaster(model.meshes);
+        float radius = 0.0f;
+        for(auto &vertex : model.meshes[0].vertices)
+            radius = std::max(radius, glm::length(vertex.Position));
+
+        unsigned int count = 1000000;
+        std::vector<glm::mat4> matrices(count);
+        std::vector<glm::vec4> spheres(count);
+        FieldGenerator(1337).Generate(matrices.data(), count, 0, spheres.data());
+        for(auto &sphere : spheres)
+            sphere.w *= radius;
+        BVH bvh;
+        bvh.Build(spheres.data(), count);
+
+        // rays from outside the ring aimed across it at different heights and angles
+        std::vector<Ray> rays;
+        for(auto i = 0U; i < 64; i++) {
+            float angle = i * 0.098f;
+            glm::vec3 origin(80.0f * std::cos(angle), (i % 8) * 0.1f - 0.4f, 80.0f * std::sin(angle));
+            rays.push_back(Ray{origin, glm::normalize(glm::vec3(0.0f, 0.0f, 0.0f) - origin)});
+        }
+        auto transform = [&](uint32_t id) { return matrices[id]; };
+        runner.Run("picking/pick/" + std::to_string(count), 1, [&](unsigned long long iterations) {
+            PickHit hit;
+            for(auto i = 0ULL; i < iterations; i++)
+                bench::DoNotOptimize(PickInstance(rays[i % rays.size()], bvh, raycaster, transform, hit));
+        });
+    }
+
+    for(unsigned int loaded : {8U, 64U}) {
+        // a material referencing four textures that are all already in textures_loaded
+        Model model;
+        for(auto i = 0U; i < loaded; i++)
+            model.loadTexture("textures/texture_" + std::to_string(i) + ".png", "texture_diffuse");
+        aiMaterial material;
+        for(auto i = 0U; i < 4; i++) {
+            aiString path("textures/texture_" + std::to_string(loaded - 1 - i) + ".png");
+            material.AddProperty(&path, AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, i));
+        }
+        runner.Run("model/loadMaterialTextures/hit/" + std::to_string(loaded), 4, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                auto textures = model.loadMaterialTextures(&material, aiTextureType_DIFFUSE, "texture_diffuse");
+                bench::DoNotOptimize(textures.data());
+            }
+        });
+    }
+
+    {
+        Shader shader(ShaderProgramDesc{}, {}, {});
+        shader.Use();
+        glm::mat4 matrix(1.0f);
+        glm::vec3 vector(1.0f, 2.0f, 3.0f);
+        runner.Run("shader/SetMat4", 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                shader.SetMat4("projection", matrix);
+        });
+        runner.Run("shader/SetVec3", 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                shader.SetVec3("lightPos", vector);
+        });
+        runner.Run("shader/SetInt", 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                shader.SetInt("texture_diffuse1", 0);
+        });
+        runner.Run("shader/SetFloat", 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++)
+                shader.SetFloat("time", 1.0f);
+        });
+    }
+
+    {
+        // every mouse move recomputes the camera basis in updateCameraVectors
+        Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+        runner.Run("camera/ProcessMouseMovement", 1, [&](unsigned long long iterations) {
+            for(auto i = 0ULL; i < iterations; i++) {
+                camera.ProcessMouseMovement(0.5f, (i & 1) ? 0.25f : -0.25f);
+                bench::DoNotOptimize(camera.Front);
+            }
+        });
+    }
+
+    std::cout << "null GL calls: " << NullGLCalls() << std::endl;
+    if(!json.empty() && !runner.WriteJson(json)) {
+        std::cerr << "failed to write " << json << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "nullgl.h"
+
+#include <glad/glad.h>
+
+namespace {
+
+unsigned long long calls = 0;
+GLuint nextName = 1;
+
+void APIENTRY genNames(GLsizei n, GLuint *names) {
+    calls++;
+    for(GLsizei i = 0; i < n; i++)
+        names[i] = nextName++;
+}
+
+GLuint APIENTRY createObject() {
+    calls++;
+    return nextName++;
+}
+
+GLuint APIENTRY createShader(GLenum) {
+    calls++;
+    return nextName++;
+}
+
+const GLubyte *APIENTRY getString(GLenum) {
+    calls++;
+    return reinterpret_cast<const GLubyte *>("null");
+}
+
+void APIENTRY getIntegerv(GLenum, GLint *data) {
+    calls++;
+    *data = 0;
+}
+
+// compile, link and completion status all succeed; log and binary lengths are zero
+void APIENTRY getObjectiv(GLuint, GLenum pname, GLint *params) {
+    calls++;
+    *params = pname == GL_COMPILE_STATUS || pname == GL_LINK_STATUS || pname == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+}
+
+GLint APIENTRY getUniformLocation(GLuint, const GLchar *) {
+    calls++;
+    return 0;
+}
+
+template<typename... Args>
+void APIENTRY ignore(Args...) {
+    calls++;
+}
+
+}
+
+void InstallNullGL() {
+    glad_glGetString = getString;
+    glad_glGetIntegerv = getIntegerv;
+    glad_glGenBuffers = genNames;
+    glad_glGenVertexArrays = genNames;
+    glad_glGenTextures = genNames;
+    glad_glBindBuffer = ignore<GLenum, GLuint>;
+    glad_glBindVertexArray = ignore<GLuint>;
+    glad_glBindTexture = ignore<GLenum, GLuint>;
+    glad_glBufferData = ignore<GLenum, GLsizeiptr, const void *, GLenum>;
+    glad_glEnableVertexAttribArray = ignore<GLuint>;
+    glad_glVertexAttribPointer = ignore<GLuint, GLint, GLenum, GLboolean, GLsizei, const void *>;
+
+    glad_glCreateProgram = createObject;
+    glad_glCreateShader = createShader;
+    glad_glShaderSource = ignore<GLuint, GLsizei, const GLchar *const *, const GLint *>;
+    glad_glCompileShader = ignore<GLuint>;
+    glad_glAttachShader = ignore<GLuint, GLuint>;
+    glad_glProgramParameteri = ignore<GLuint, GLenum, GLint>;
+    glad_glLinkProgram = ignore<GLuint>;
+    glad_glDeleteShader = ignore<GLuint>;
+    glad_glDeleteProgram = ignore<GLuint>;
+    glad_glGetShaderiv = getObjectiv;
+    glad_glGetProgramiv = getObjectiv;
+    glad_glUseProgram = ignore<GLuint>;
+
+    glad_glGetUniformLocation = getUniformLocation;
+    glad_glUniform1i = ignore<GLint, GLint>;
+    glad_glUniform1f = ignore<GLint, GLfloat>;
+    glad_glUniform3fv = ignore<GLint, GLsizei, const GLfloat *>;
+    glad_glUniformMatrix4fv = ignore<GLint, GLsizei, GLboolean, const GLfloat *>;
+}
+
+unsigned long long NullGLCalls() {
+    return calls;
+}
@@ -0,0 +1,12 @@
+#ifndef NULLGL_H
+#define NULLGL_H
+
+// Points glad's function pointers at no-op implementations so engine code that issues GL calls can run
+// without a context. Object creation hands out increasing names, status queries report success and
+// glGetUniformLocation always finds the uniform. Only the entry points the benchmarked paths use are set.
+void InstallNullGL();
+
+// number of GL calls made since InstallNullGL, to keep the calls from looking dead to the optimiser
+unsigned long long NullGLCalls();
+
+#endif
@@ -0,0 +1,113 @@
+// Compares the native OBJ loader against Assimp on a generated heightfield mesh.
+// usage: ObjBench [triangles] [file]   (defaults: 10000000 triangles, /tmp/objbench.obj)
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "objloader.h"
+#include "jobsystem.h"
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Writes a (n + 1) x (n + 1) vertex grid with 2 * n * n triangles and full v/vt/vn corners
+static void generateObj(const std::string &path, size_t triangles) {
+    auto n = static_cast<size_t>(std::sqrt(triangles / 2.0));
+    FILE *file = std::fopen(path.c_str(), "w");
+    if(!file) {
+        std::cerr << "failed to create " << path << std::endl;
+        std::exit(1);
+    }
+
+    std::fprintf(file, "# ObjBench heightfield, %zu triangles\no Grid\n", 2 * n * n);
+    for(auto z = 0U; z <= n; z++) {
+        for(auto x = 0U; x <= n; x++) {
+            float height = std::sin(x * 0.05f) * std::cos(z * 0.05f);
+            std::fprintf(file, "v %.6f %.6f %.6f\n", x * 0.01f, height, z * 0.01f);
+        }
+    }
+    for(auto z = 0U; z <= n; z++)
+        for(auto x = 0U; x <= n; x++)
+            std::fprintf(file, "vt %.6f %.6f\n", float(x) / n, float(z) / n);
+    for(auto z = 0U; z <= n; z++)
+        for(auto x = 0U; x <= n; x++)
+            std::fprintf(file, "vn %.4f %.4f %.4f\n", 0.0f, 1.0f, 0.0f);
+
+    for(auto z = 0U; z < n; z++) {
+        for(auto x = 0U; x < n; x++) {
+            size_t a = z * (n + 1) + x + 1;
+            size_t b = a + 1;
+            size_t c = a + n + 1;
+            size_t d = c + 1;
+            std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+            std::fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+        }
+    }
+    std::fclose(file);
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::string path = argc > 2 ? argv[2] : "/tmp/objbench.obj";
+
+    auto start = std::chrono::steady_clock::now();
+    generateObj(path, triangles);
+    std::cout << "generated " << path << " in " << elapsedMs(start) << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    ObjScene scene;
+    if(!LoadObj(path, scene)) {
+        std::cerr << "native loader failed" << std::endl;
+        return 1;
+    }
+    double nativeMs = elapsedMs(start);
+    size_t nativeVertices = 0, nativeIndices = 0;
+    for(auto &mesh : scene.meshes) {
+        nativeVertices += mesh.vertices.size();
+        nativeIndices += mesh.indices.size();
+    }
+    scene = ObjScene();
+
+    // same flags as Model::loadModel, plus the Vertex conversion Model::processMesh does
+    start = std::chrono::steady_clock::now();
+    size_t assimpVertices = 0, assimpIndices = 0;
+    {
+        Assimp::Importer importer;
+        const aiScene *aiscene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        if(!aiscene || !aiscene->mRootNode) {
+            std::cerr << "assimp error: " << importer.GetErrorString() << std::endl;
+            return 1;
+        }
+        for(auto m = 0U; m < aiscene->mNumMeshes; m++) {
+            const aiMesh *mesh = aiscene->mMeshes[m];
+            std::vector<Vertex> vertices(mesh->mNumVertices);
+            for(auto i = 0U; i < mesh->mNumVertices; i++) {
+                vertices[i].Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+                vertices[i].Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+                vertices[i].TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            }
+            std::vector<unsigned int> indices;
+            indices.reserve(mesh->mNumFaces * 3);
+            for(auto i = 0U; i < mesh->mNumFaces; i++)
+                for(auto j = 0U; j < mesh->mFaces[i].mNumIndices; j++)
+                    indices.emplace_back(mesh->mFaces[i].mIndices[j]);
+            assimpVertices += vertices.size();
+            assimpIndices += indices.size();
+        }
+    }
+    double assimpMs = elapsedMs(start);
+
+    std::printf("native: %10.1f ms  %zu vertices  %zu indices  (%u threads)\n", nativeMs, nativeVertices, nativeIndices, JobSystem::Instance().ThreadCount());
+    std::printf("assimp: %10.1f ms  %zu vertices  %zu indices\n", assimpMs, assimpVertices, assimpIndices);
+    std::printf("speedup: %.1fx\n", assimpMs / nativeMs);
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,108 @@
+# Turns shaders/*.glsl into two headers:
+#   shaders_embedded.h  - every shader source as a constexpr char array, looked up by file name at runtime
+#   shader_reflection.h - per-file attribute locations, uniform names, explicit uniform locations and uniform
+#                         and storage block bindings, so C++ code that refers to a renamed or removed GLSL
+#                         symbol stops compiling. Explicit uniform locations are also listed in a runtime table, which
+#                         SPIR-V programs (whose names the driver may strip) use to resolve uniforms by name.
+# Usage: cmake -DSHADER_DIR=<dir> -DOUTPUT_DIR=<dir> -P EmbedShaders.cmake
+
+cmake_policy(VERSION 3.24)
+
+file(GLOB shaderFiles ${SHADER_DIR}/*.glsl)
+list(SORT shaderFiles)
+
+set(embedded "// Generated by cmake/EmbedShaders.cmake from shaders/*.glsl, do not edit\n")
+string(APPEND embedded "#ifndef SHADERS_EMBEDDED_H\n#define SHADERS_EMBEDDED_H\n\n#include <cstddef>\n\n")
+string(APPEND embedded "struct EmbeddedShader {\n    const char *name;\n    const char *source;\n    size_t size;\n};\n\n")
+string(APPEND embedded "namespace embedded_shaders {\n\n")
+
+set(reflection "// Generated by cmake/EmbedShaders.cmake from shaders/*.glsl, do not edit\n")
+string(APPEND reflection "#ifndef SHADER_REFLECTION_H\n#define SHADER_REFLECTION_H\n\n#include <cstddef>\n\nnamespace shader_reflection {\n\n")
+string(APPEND reflection "struct UniformLocation {\n    const char *name;\n    int location;\n};\n\n")
+string(APPEND reflection "struct FileUniforms {\n    const char *file;\n    const UniformLocation *uniforms;\n    size_t count;\n};\n")
+set(locationTable "")
+
+set(table "")
+foreach(shaderFile ${shaderFiles})
+    get_filename_component(fileName ${shaderFile} NAME)
+    get_filename_component(stem ${shaderFile} NAME_WE)
+
+    file(READ ${shaderFile} hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(APPEND embedded "constexpr char ${stem}_glsl[] = {${bytes}0x00};\n")
+    string(APPEND table "    {\"${fileName}\", ${stem}_glsl, sizeof(${stem}_glsl) - 1},\n")
+
+    # file(STRINGS) also splits on ';', which is harmless here: every declaration we match ends at one
+    file(STRINGS ${shaderFile} lines)
+    set(attribs "")
+    set(uniforms "")
+    set(blocks "")
+    set(locations "")
+    set(seen "")
+    foreach(line ${lines})
+        if(line MATCHES "^[ \t]*layout[ \t]*\\([ \t]*location[ \t]*=[ \t]*([0-9]+)[ \t]*\\)[ \t]*in[ \t]+[A-Za-z0-9_]+[ \t]+([A-Za-z0-9_]+)")
+            set(name ${CMAKE_MATCH_2})
+            set(value ${CMAKE_MATCH_1})
+            if(NOT "attrib:${name}" IN_LIST seen)
+                list(APPEND seen "attrib:${name}")
+                string(APPEND attribs "        constexpr unsigned int ${name} = ${value};\n")
+            endif()
+        elseif(line MATCHES "^[ \t]*(layout[ \t]*\\(([^)]*)\\)[ \t]*)?((readonly|writeonly|coherent|restrict)[ \t]+)*(uniform|buffer)[ \t]+([A-Za-z0-9_]+)[ \t]*{?[ \t]*$")
+            set(name ${CMAKE_MATCH_6})
+            set(qualifiers "${CMAKE_MATCH_2}")
+            if(NOT "block:${name}" IN_LIST seen)
+                list(APPEND seen "block:${name}")
+                string(APPEND blocks "        constexpr const char *${name} = \"${name}\";\n")
+                if(qualifiers MATCHES "binding[ \t]*=[ \t]*([0-9]+)")
+                    string(APPEND blocks "        constexpr unsigned int ${name}Binding = ${CMAKE_MATCH_1};\n")
+                endif()
+            endif()
+        elseif(line MATCHES "^[ \t]*(layout[ \t]*\\(([^)]*)\\)[ \t]*)?uniform[ \t]+[A-Za-z0-9_]+[ \t]+([A-Za-z0-9_]+)")
+            set(name ${CMAKE_MATCH_3})
+            set(qualifiers "${CMAKE_MATCH_2}")
+            if(NOT "uniform:${name}" IN_LIST seen)
+                list(APPEND seen "uniform:${name}")
+                string(APPEND uniforms "        constexpr const char *${name} = \"${name}\";\n")
+                if(qualifiers MATCHES "location[ \t]*=[ \t]*([0-9]+)")
+                    string(APPEND locations "        {\"${name}\", ${CMAKE_MATCH_1}},\n")
+                endif()
+            endif()
+        endif()
+    endforeach()
+
+    string(APPEND reflection "\nnamespace ${stem} {\n")
+    string(APPEND reflection "    constexpr const char *file = \"${fileName}\";\n")
+    if(attribs)
+        string(APPEND reflection "    namespace attrib {\n${attribs}    }\n")
+    endif()
+    if(uniforms)
+        string(APPEND reflection "    namespace uniform {\n${uniforms}    }\n")
+    endif()
+    if(blocks)
+        string(APPEND reflection "    namespace block {\n${blocks}    }\n")
+    endif()
+    if(locations)
+        string(APPEND reflection "    constexpr UniformLocation uniformLocations[] = {\n${locations}    };\n")
+        string(APPEND locationTable "    {\"${fileName}\", ${stem}::uniformLocations, sizeof(${stem}::uniformLocations) / sizeof(UniformLocation)},\n")
+    endif()
+    string(APPEND reflection "}\n")
+endforeach()
+
+string(APPEND embedded "\nconstexpr EmbeddedShader files[] = {\n${table}};\n\n}\n\n#endif\n")
+string(APPEND reflection "\n// every file with explicit uniform locations, terminated by an empty entry\n")
+string(APPEND reflection "constexpr FileUniforms uniformLocations[] = {\n${locationTable}    {nullptr, nullptr, 0},\n};\n")
+string(APPEND reflection "\n}\n\n#endif\n")
+
+# only touch the outputs when they change, so an unrelated shader edit does not rebuild every includer
+function(write_if_changed path content)
+    set(previous "")
+    if(EXISTS ${path})
+        file(READ ${path} previous)
+    endif()
+    if(NOT previous STREQUAL content)
+        file(WRITE ${path} "${content}")
+    endif()
+endfunction()
+
+write_if_changed(${OUTPUT_DIR}/shaders_embedded.h "${embedded}")
+write_if_changed(${OUTPUT_DIR}/shader_reflection.h "${reflection}")
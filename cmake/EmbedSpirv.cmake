@@ -0,0 +1,33 @@
+# Packs the SPIR-V binaries compiled from shaders/*.glsl into shaders_spirv.h.
+# Usage: cmake -DSPIRV_DIR=<dir> -DOUTPUT=<file> -DVARIANTS=<file|stage|DEFINE,DEFINE+...> -P EmbedSpirv.cmake
+
+cmake_policy(VERSION 3.24)
+
+string(REPLACE "+" ";" variants "${VARIANTS}")
+
+set(header "// Generated by cmake/EmbedSpirv.cmake, do not edit\n")
+string(APPEND header "#ifndef SHADERS_SPIRV_H\n#define SHADERS_SPIRV_H\n\n#include <cstddef>\n\n")
+string(APPEND header "struct SpirvShader {\n    const char *name;\n    const char *stage;\n    const char *defines;\n")
+string(APPEND header "    const unsigned char *binary;\n    size_t size;\n};\n\nnamespace spirv_shaders {\n\n")
+
+set(table "")
+foreach(variant ${variants})
+    string(REGEX MATCH "^([^|]+)\\|([^|]+)\\|(.*)$" _ "${variant}")
+    set(file ${CMAKE_MATCH_1})
+    set(stage ${CMAKE_MATCH_2})
+    set(defines "${CMAKE_MATCH_3}")
+    get_filename_component(stem ${file} NAME_WE)
+    string(REPLACE "," "_" suffix "${defines}")
+    set(symbol "${stem}_${stage}")
+    if(suffix)
+        set(symbol "${symbol}_${suffix}")
+    endif()
+
+    file(READ ${SPIRV_DIR}/${symbol}.spv hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(APPEND header "alignas(4) constexpr unsigned char ${symbol}[] = {${bytes}};\n")
+    string(APPEND table "    {\"${file}\", \"${stage}\", \"${defines}\", ${symbol}, sizeof(${symbol})},\n")
+endforeach()
+
+string(APPEND header "\nconstexpr SpirvShader files[] = {\n${table}};\n\n}\n\n#endif\n")
+file(WRITE ${OUTPUT} "${header}")
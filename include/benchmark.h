@@ -0,0 +1,52 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Command line of the headless benchmark:
+//   --bench [--frames N] [--warmup N] [--seed N] [--counts 10000,100000,...] [--out file.json] [--camera-path file]
+//   [--target-ms N] [--lights N] [--light-counts 10,100,...]
+// --camera-path on its own replays a recorded CameraPath in the interactive viewer; --target-ms sets the
+// viewer's dynamic resolution budget. --lights sets the number of point lights in both. After the asteroid
+// sweep the benchmark sweeps the point light count over --light-counts with the smallest asteroid count.
+struct BenchOptions {
+    bool enabled = false;
+    unsigned int frames = 600;
+    unsigned int warmup = 60;
+    uint32_t seed = 1337;
+    std::vector<unsigned int> counts{10000, 100000, 1000000, 10000000};
+    // empty writes the report to stdout
+    std::string output;
+    // recorded CameraPath to fly instead of the built-in orbit
+    std::string cameraPath;
+    // GPU frame time dynamic resolution aims for; 0 uses the display's refresh period
+    float targetMs = 0.0f;
+    unsigned int lights = 256;
+    std::vector<unsigned int> lightCounts{10, 100, 1000, 4000};
+};
+
+// Per asteroid and light count: one CPU and one GPU time per measured frame, plus the work submitted each frame
+struct BenchResult {
+    unsigned int asteroids = 0;
+    unsigned int lights = 0;
+    // most clusters that overflowed MAX_LIGHTS_PER_CLUSTER in any measured frame
+    unsigned int overflowClusters = 0;
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;
+};
+
+// returns false and prints usage on an unknown or malformed argument
+bool ParseBenchOptions(int argc, char **argv, BenchOptions &options);
+// nearest-rank percentile, p in [0, 100]
+double Percentile(std::vector<double> values, double p);
+// scripted camera: one orbit around the planet that dips through the asteroid ring, t in [0, 1]
+glm::mat4 BenchCameraView(float t);
+// writes the JSON report to options.output, or stdout when it is empty
+bool WriteBenchReport(const BenchOptions &options, const std::vector<BenchResult> &results, const std::string &renderer);
+
+#endif
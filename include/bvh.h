@@ -0,0 +1,81 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Six inward-facing planes (xyz normal, w distance) extracted from a projection * view matrix
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4 &viewProjection);
+    bool Intersects(const glm::vec4 &sphere) const;
+};
+
+struct RayHit {
+    uint32_t instance;
+    // distance along the ray to where it enters the instance's bounding sphere (0 when it starts inside)
+    float distance;
+};
+
+// Linear BVH (Karras 2012, "Maximizing parallelism in the construction of BVHs, octrees and k-d trees")
+// over instance bounding spheres, given as xyz = center, w = radius and indexed by instance id.
+// Instances are sorted by the 30-bit Morton code of their center with a parallel radix sort and grouped
+// LEAF_SIZE to a leaf; every internal node is then emitted independently from the sorted codes, and
+// bounds are filled in bottom-up. Refit() keeps the topology and only recomputes bounds, so it suits
+// instances that move a little per frame; rebuild when they have drifted far.
+class BVH {
+public:
+    static const unsigned int LEAF_SIZE = 4;
+
+    // runs on the job system; threads == 0 uses every pool thread
+    void Build(const glm::vec4 *spheres, uint32_t count, unsigned int threads = 0);
+    // recomputes every bound from the (moved) spheres, in parallel
+    void Refit(const glm::vec4 *spheres, unsigned int threads = 0);
+    // recomputes only the leaves holding `moved` and their ancestors, stopping where bounds stop changing
+    void Refit(const glm::vec4 *spheres, const std::vector<uint32_t> &moved);
+
+    // appends the ids of instances whose sphere intersects the frustum
+    void QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const;
+    // appends the ids of instances whose sphere overlaps the query sphere
+    void QuerySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const;
+    // appends every instance whose sphere the ray hits within maxDistance, in no particular order;
+    // direction must be normalized
+    void QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<RayHit> &out) const;
+
+    uint32_t Size() const { return count; }
+    size_t NodeCount() const { return nodes.size(); }
+    bool Empty() const { return count == 0; }
+
+private:
+    // internal nodes come first (root at 0), then the leaves; a leaf stores its range in `order`
+    struct Node {
+        glm::vec3 min;
+        uint32_t left;
+        glm::vec3 max;
+        uint32_t right;
+    };
+
+    bool isLeaf(uint32_t node) const { return node >= leafStart; }
+    void fitLeaf(uint32_t node);
+    void fitInternal(uint32_t node);
+    // test(node) returns OUTSIDE, PARTIAL or INSIDE; visit(slot, inside) is called per instance of every
+    // reached leaf, with inside set when an ancestor was entirely inside and per-instance tests can be skipped
+    template<typename NodeTest, typename InstanceVisit>
+    void traverse(NodeTest &&test, InstanceVisit &&visit) const;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> parents;
+    // instance ids and a copy of their spheres in Morton order, so leaves read contiguous memory
+    std::vector<uint32_t> order;
+    std::vector<glm::vec4> sorted;
+    // position of every instance in `order`, for incremental refits
+    std::vector<uint32_t> slotOf;
+    uint32_t count = 0;
+    uint32_t leafStart = 0;
+    // edges from the root to the deepest leaf, which sizes the traversal stack
+    uint32_t depth = 0;
+};
+
+#endif
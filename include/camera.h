@@ -117,6 +117,16 @@ public:
         MovementSpeed = speed;
     }
 
+    // places the camera directly, e.g. from a recorded CameraPath
+    void SetState(glm::vec3 position, float yaw, float pitch, float zoom)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        Zoom = zoom;
+        updateCameraVectors();
+    }
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
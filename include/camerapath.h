@@ -0,0 +1,49 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "camera.h"
+
+// Camera state at `time` seconds after recording started
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// key holding camera's current state at `time`
+CameraKey CaptureCameraKey(float time, const Camera &camera);
+// blends position, yaw (the short way round), pitch and zoom by t in [0, 1]
+CameraKey InterpolateCameraKeys(const CameraKey &a, const CameraKey &b, float t);
+
+// Recorded camera flight. Replays sample the path at an explicit time rather than the wall clock, so
+// stepping it at a fixed timestep renders the same views on every build and machine.
+// File format: "CPTH", uint32 version, uint32 key count, then 7 floats per key (time, position, yaw, pitch,
+// zoom) in host byte order.
+class CameraPath {
+public:
+    // seconds a replay advances per rendered frame
+    static constexpr float REPLAY_STEP = 1.0f / 60.0f;
+
+    void Clear() { keys.clear(); }
+    // appends the camera's current state; times must not decrease
+    void Record(float time, const Camera &camera);
+    bool Save(const std::string &path) const;
+    bool Load(const std::string &path);
+    // interpolates position, yaw (the short way round), pitch and zoom at `time` and applies them to camera;
+    // with loop the time wraps around the path's duration, otherwise it clamps to the last key
+    void Apply(float time, Camera &camera, bool loop) const;
+
+    float Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+    size_t Size() const { return keys.size(); }
+    bool Empty() const { return keys.empty(); }
+
+private:
+    std::vector<CameraKey> keys;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Shader;
+
+// std430 layout of PointLight in shaders/clusters.glsl
+struct PointLight {
+    // world space position, range in w
+    glm::vec4 positionRange;
+    // linear color, intensity in w
+    glm::vec4 colorIntensity;
+};
+
+// Clustered forward lighting (Olsson et al. 2012, "Clustered deferred and forward shading"). Every frame a
+// compute pass bins the lights into a GRID_X x GRID_Y x GRID_Z froxel grid with exponential depth slices
+// and writes per-cluster index lists to storage buffers; the forward shader (CLUSTERED_LIGHTING) finds its
+// cluster from gl_FragCoord and view depth and only shades the lights listed there. Cost per fragment thus
+// follows the lights actually nearby rather than the total count. Clusters that overflow their list are
+// counted on the GPU and read back FRAMES_IN_FLIGHT - 1 frames later without stalling.
+class ClusteredLighting {
+public:
+    static const unsigned int GRID_X = 16, GRID_Y = 9, GRID_Z = 24;
+    static const unsigned int CLUSTERS = GRID_X * GRID_Y * GRID_Z;
+    // matches MAX_CLUSTER_LIGHTS in clusters.glsl; further lights overlapping a cluster are dropped
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 128;
+    static const unsigned int MAX_LIGHTS = 4096;
+    // matches local_size_x in lightCulling.glsl
+    static const unsigned int WORKGROUP_SIZE = 128;
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    // depth range the slices span; nearer fragments use the first slice and farther ones the last
+    ClusteredLighting(float nearDepth = 1.0f, float farDepth = 10000.0f);
+
+    // uploads up to MAX_LIGHTS lights
+    void SetLights(const std::vector<PointLight> &lights);
+    // rebuilds the cluster lists for this camera and binds the buffers for the forward pass
+    void Cull(Shader &culling, const glm::mat4 &projection, const glm::mat4 &view);
+    // sets the cluster uniforms of a CLUSTERED_LIGHTING program for a viewport of width x height pixels
+    void Apply(Shader &forward, int width, int height) const;
+
+    unsigned int LightCount() const { return lightCount; }
+    // as of the last culling pass read back: clusters holding more than MAX_LIGHTS_PER_CLUSTER lights, and
+    // the light references they dropped
+    unsigned int OverflowClusters() const { return overflowClusters; }
+    unsigned int DroppedLights() const { return droppedLights; }
+
+private:
+    void create();
+    // reads back the pass the slot about to be reused holds, if the GPU is done with it
+    void resolve(unsigned int slot);
+
+    float nearDepth, farDepth;
+    unsigned int lightCount = 0;
+    unsigned int lightBuffer = 0, countBuffer = 0, indexBuffer = 0;
+    unsigned int overflowBuffer = 0, readbackBuffer = 0;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    unsigned int frame = 0;
+    unsigned int overflowClusters = 0, droppedLights = 0;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+class Shader;
+
+// Tuning of the resolution controller. Errors are relative to the target: (target - measured) / target.
+struct ResolutionParams {
+    // GPU time budget for the scene and the upscale, in milliseconds
+    float targetMs = 16.6f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float proportionalGain = 0.5f;
+    float integralGain = 0.1f;
+    // errors inside this band are treated as on target, so a steady frame does not hunt
+    float deadband = 0.05f;
+    // scale changes smaller than this are not applied
+    float minStep = 0.02f;
+};
+
+// Renders the scene into an offscreen multisampled target at a fraction of the window size and upscales it
+// to the default framebuffer with a Catmull-Rom filter. Targets are allocated once at full size and the
+// scene renders into their lower-left corner, so changing the scale never reallocates.
+// The scale is driven by a PI controller on the GPU time of Begin() .. End(), measured with GL_TIME_ELAPSED
+// queries read back FRAMES_IN_FLIGHT - 1 frames later. The controller works on the pixel count (scale
+// squared), which GPU time follows roughly linearly when fill-bound, in velocity form so clamping the
+// output cannot wind the integral up.
+class DynamicResolution {
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    explicit DynamicResolution(ResolutionParams params = ResolutionParams());
+
+    // (re)allocates the targets for a window of width x height when it changed
+    void Resize(int width, int height, int samples);
+    // feeds the latest GPU time to the controller; call once per frame before Begin()
+    void Update();
+    // binds the offscreen target with the viewport set to the scaled size
+    void Begin();
+    // resolves the scaled region and upscales it over the whole default framebuffer
+    void End(Shader &upscale);
+
+    void SetEnabled(bool enabled);
+    bool Enabled() const { return enabled; }
+    ResolutionParams &Params() { return params; }
+
+    float Scale() const { return scale; }
+    int ScaledWidth() const;
+    int ScaledHeight() const;
+    // last measured GPU time of the scaled frame, -1 before the first result
+    double GpuMs() const { return gpuMs; }
+
+private:
+    void release();
+
+    ResolutionParams params;
+    bool enabled = true;
+    float scale = 1.0f;
+    float area = 1.0f;
+    float previousError = 0.0f;
+    double gpuMs = -1.0;
+
+    int width = 0, height = 0, samples = 0;
+    unsigned int sceneFramebuffer = 0, colorBuffer = 0, depthBuffer = 0;
+    unsigned int resolveFramebuffer = 0, resolveTexture = 0;
+    unsigned int emptyVAO = 0;
+    unsigned int queries[FRAMES_IN_FLIGHT] = {};
+    bool queryPending[FRAMES_IN_FLIGHT] = {};
+    unsigned int frame = 0;
+};
+
+#endif
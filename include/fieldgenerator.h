@@ -0,0 +1,41 @@
+#ifndef FIELDGENERATOR_H
+#define FIELDGENERATOR_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// Shape of the asteroid ring around the planet
+struct FieldParams {
+    float radius = 50.0f;
+    // maximum displacement off the ring along each axis; y is squashed by heightScale
+    float offset = 2.5f;
+    float heightScale = 0.4f;
+    float minScale = 0.05f;
+    float maxScale = 0.25f;
+    glm::vec3 rotationAxis = glm::vec3(0.4f, 0.6f, 0.8f);
+};
+
+// Builds asteroid transforms from a counter-based PRNG (Philox4x32-10): instance i's random numbers are
+// a pure function of (seed, i), so a field is bit-identical for any thread count or range split.
+// Instances are processed in SoA batches of BATCH lanes written as plain loops the compiler vectorises,
+// and each matrix is written out once, front to back, so `out` may point into a mapped GPU buffer.
+class FieldGenerator {
+public:
+    static constexpr unsigned int BATCH = 16;
+
+    explicit FieldGenerator(uint32_t seed, FieldParams params = FieldParams());
+
+    // writes `count` column-major transforms on the job system; threads == 0 uses every pool thread, 1 runs
+    // on the calling thread and anything else caps the number of jobs.
+    // bounds, when given, receives each instance's translation in xyz and uniform scale in w, which
+    // times the mesh's bounding radius is the instance's bounding sphere
+    void Generate(glm::mat4 *out, unsigned int count, unsigned int threads = 0, glm::vec4 *bounds = nullptr) const;
+    // writes instances [first, first + n) of a field of `count` instances to out[0, n) (and bounds[0, n))
+    void GenerateRange(glm::mat4 *out, unsigned int first, unsigned int n, unsigned int count, glm::vec4 *bounds = nullptr) const;
+
+private:
+    uint32_t seed;
+    FieldParams params;
+};
+
+#endif
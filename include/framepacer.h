@@ -0,0 +1,53 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Bounds how many frames the driver may queue ahead of the GPU and estimates input-to-photon latency.
+// Every frame ends with a GL_TIMESTAMP query and a fence; the latency of a frame is the GPU time from
+// LatchInput() to the frame's last command, plus the wait for scan-out when vsync is on. Results are read
+// back without stalling, except when Throttle() is asked to wait.
+class FramePacer {
+public:
+    enum class Limit { Off, Fence, Finish };
+    // frames tracked for the latency estimate when nothing waits on them
+    static const unsigned int MAX_TRACKED = 8;
+
+    // Fence: Throttle() waits until at most maxQueued earlier frames are unfinished on the GPU;
+    // Finish: every frame ends with glFinish(), so nothing is ever queued
+    void SetLimit(Limit limit, unsigned int maxQueued);
+    // call before sampling input so the wait happens before, not after, the latch
+    void Throttle();
+    // marks the moment the camera input for this frame was read
+    void LatchInput();
+    // call after SwapBuffers; scanoutMs is the display wait to add, 0 without vsync
+    void EndFrame(double scanoutMs);
+
+    double LatencyMs() const { return latencyMs; }
+    double ThrottleMs() const { return throttleMs; }
+    size_t Queued() const { return frames.size(); }
+
+private:
+    struct InFlight {
+        GLsync fence;
+        unsigned int query;
+        GLint64 latch;
+        double scanoutMs;
+    };
+
+    // folds the oldest frame into the estimate and releases it; false if its query is not ready and !wait
+    bool resolve(bool wait);
+
+    Limit limit = Limit::Off;
+    unsigned int maxQueued = 1;
+    std::deque<InFlight> frames;
+    std::vector<unsigned int> freeQueries;
+    GLint64 latch = -1;
+    double latencyMs = 0.0;
+    double throttleMs = 0.0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "triplebuffer.h"
+
+// Hands frame packets from a producer thread (simulation) to a consumer thread (rendering) that runs one
+// frame behind. Packets travel through a lock-free TripleBuffer; the mutex and condition variable only put
+// a side to sleep when it gets ahead. The producer may have at most one submitted packet the consumer has
+// not picked up yet, so while the consumer works on packet N the producer builds N + 1 and the frame time
+// is the slower of the two rather than their sum.
+template<typename Packet>
+class FramePipeline {
+public:
+    // producer: the packet to fill next; blocks until the consumer has picked up the previous one.
+    // Returns nullptr once the pipeline is closed.
+    Packet *Begin() {
+        if(produced.load(std::memory_order_acquire) > consumed.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return closed.load() || produced.load() <= consumed.load(); });
+        }
+        return closed.load(std::memory_order_acquire) ? nullptr : &packets.Back();
+    }
+    void Submit() {
+        packets.Publish();
+        produced.fetch_add(1, std::memory_order_release);
+        notify();
+    }
+
+    // consumer: the next packet, waiting up to `timeout` for it; nullptr on timeout or once the pipeline
+    // is closed. The producer never has more than one packet outstanding, so none is skipped.
+    const Packet *Acquire(std::chrono::milliseconds timeout) {
+        bool fresh = packets.Update();
+        if(!fresh) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, timeout, [&] { return closed.load() || (fresh = packets.Update()); });
+        }
+        if(!fresh)
+            return nullptr;
+        consumed.fetch_add(1, std::memory_order_release);
+        notify();
+        return &packets.Front();
+    }
+
+    // packets submitted but not yet picked up by the consumer
+    uint64_t Depth() const {
+        uint64_t submitted = produced.load(), taken = consumed.load();
+        return submitted > taken ? submitted - taken : 0;
+    }
+
+    // wakes and releases both sides for shutdown
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed.store(true, std::memory_order_release);
+        }
+        wake.notify_all();
+    }
+
+private:
+    void notify() {
+        // taking the lock orders the counter change before a waiter's predicate check, so no wakeup is lost
+        { std::lock_guard<std::mutex> lock(mutex); }
+        wake.notify_all();
+    }
+
+    TripleBuffer<Packet> packets;
+    std::atomic<uint64_t> produced{0};
+    std::atomic<uint64_t> consumed{0};
+    std::mutex mutex;
+    std::condition_variable wake;
+    // read by Begin() outside the lock on its fast path
+    std::atomic<bool> closed{false};
+};
+
+#endif
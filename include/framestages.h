@@ -0,0 +1,190 @@
+#ifndef FRAMESTAGES_H
+#define FRAMESTAGES_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bvh.h"
+#include "camera.h"
+#include "camerapath.h"
+#include "clusteredlighting.h"
+#include "impostor.h"
+#include "picking.h"
+#include "shadowcascades.h"
+
+class AsteroidPhysics;
+class Model;
+class Shader;
+class Skybox;
+
+// The per-frame stages of the viewer and the benchmark, grouped by the thread that runs them. The
+// simulation thread steps the camera and culls against an AsteroidField through SimulationState; the
+// render thread (the main thread, which holds the GL context) draws from RenderState. All that crosses
+// between the two is a FramePacket handed over by a FramePipeline. The benchmark runs both halves on the
+// main thread, with no simulation thread.
+
+// Input gathered on the main thread by the GLFW callbacks and the debug window, and taken by the
+// simulation thread once per frame. Offsets accumulate and commands latch until taken.
+struct PendingInput {
+    glm::vec2 look = glm::vec2(0.0f);
+    float scroll = 0.0f;
+    // left click outside ImGui, at `cursor` in a window of `windowSize`
+    bool pick = false;
+    glm::vec2 cursor = glm::vec2(0.0f);
+    glm::vec2 windowSize = glm::vec2(1.0f);
+    // held keys; the camera only flies while the right button is down
+    bool flying = false;
+    bool forward = false, backward = false, left = false, right = false, fast = false;
+    // debug window settings and camera path buttons
+    bool frustumCulling = true;
+    bool shadows = true, cacheShadows = true;
+    // degrees; the sun sits in this direction as seen from the planet
+    float sunAzimuth = 35.0f, sunElevation = 20.0f;
+    // visible asteroids farther than this from the camera are drawn as impostors
+    bool impostors = true;
+    float impostorDistance = 60.0f;
+    bool loopReplay = true;
+    bool record = false, stopRecording = false, replay = false, stopReplay = false, savePath = false, loadPath = false;
+};
+
+// recording samples the camera every simulation step and replays advance one step at a time, so both
+// run on simulation time rather than the wall clock
+enum class PathMode { Live, Recording, Replaying };
+
+// Everything the render thread needs to draw and annotate one frame. The simulation thread fills one
+// while the render thread draws the previous one; once submitted a packet is not modified.
+struct FramePacket {
+    uint64_t index = 0;
+    glm::mat4 projection, view;
+    glm::vec3 cameraPosition;
+    // the camera `view` was built from; live frames re-aim it with input that arrived since
+    Camera camera;
+    bool lateLatch = false;
+    // with culling, only these ids are drawn
+    bool culled = false;
+    std::vector<uint32_t> visible;
+    // visible asteroids past the impostor distance, drawn as impostors
+    std::vector<uint32_t> impostors;
+    // cascades for this view and, for the dirty ones, the asteroids that cast into them
+    ShadowFrame shadow;
+    std::vector<uint32_t> shadowCasters[SHADOW_CASCADES];
+    // fresh matrices for the physics bodies at the front of the instance buffer; empty when unchanged
+    std::vector<glm::mat4> physicsMatrices;
+    // overlay
+    unsigned int simSteps = 0;
+    double simMs = 0.0;
+    bool picked = false;
+    PickHit pick;
+    double pickMs = 0.0;
+    PathMode pathMode = PathMode::Live;
+    size_t pathKeys = 0;
+    float pathDuration = 0.0f;
+};
+
+// CPU side of the asteroid ring, filled on the main thread at load and owned by the simulation thread once
+// it runs: the bounds it refits as physics bodies move and the index it culls and picks against
+struct AsteroidField {
+    unsigned int count = 0;
+    // the FieldGenerator seed, so a single matrix can be recomputed on demand
+    uint32_t seed = 0;
+    // per-instance bounding spheres (xyz center, w radius), kept so moving asteroids can refit the BVH
+    std::vector<glm::vec4> bounds;
+    BVH index;
+    CascadedShadows shadows;
+    // set once the impostor atlas has baked; without it every visible asteroid is drawn as a mesh
+    bool impostorsBaked = false;
+};
+
+// Simulation thread: fixed-step camera, path recording and replay, physics hand-off, picking, culling
+// and shadow planning. Everything here belongs to that thread once it runs; `physics` is shared with the
+// render thread only through its thread-safe pause flag and counters.
+struct SimulationState {
+    // wall time accumulates and is consumed in STEP seconds, at most MAX_STEPS per frame so a slow frame
+    // cannot snowball into ever more steps; the rest of a long stall is dropped
+    static constexpr double STEP = 1.0 / 120.0;
+    static constexpr unsigned int MAX_STEPS = 8;
+
+    SimulationState(AsteroidField &field, AsteroidPhysics &physics, const MeshRaycaster &raycaster, CameraPath &path,
+                    std::string pathFile, float aspect);
+
+    AsteroidField &field;
+    AsteroidPhysics &physics;
+    const MeshRaycaster &raycaster;
+    CameraPath &path;
+    std::string pathFile;
+    float aspect;
+    // the first physicsInstances.size() instances are rigid bodies
+    std::vector<uint32_t> physicsInstances;
+
+    Camera camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    PathMode pathMode = PathMode::Live;
+    unsigned int recordStep = 0, replayStep = 0;
+    double accumulator = 0.0;
+    // glfwGetTime() of the last frame; set when the thread starts, so setup time is not simulated
+    double lastTime = 0.0;
+    CameraKey previousCamera;
+    std::vector<glm::mat4> physicsMatrices;
+    PickHit pick;
+    bool picked = false;
+    double pickMs = 0.0;
+    uint64_t frame = 0;
+};
+
+// the programs the scene stages draw with, all from the ShaderLibrary
+struct SceneShaders {
+    Shader &forward, &ring, &shadow, &ringShadow, &impostor, &lightCulling, &skybox;
+};
+
+// Render thread: the GL objects the shadow and scene passes draw from. Created with the context current
+// and only touched from the thread that holds it.
+struct RenderState {
+    // creates the instance id buffers and gives every rock VAO its instance id attribute
+    RenderState(const SceneShaders &shaders, Model &planet, Model &rock, Skybox &skybox);
+
+    SceneShaders shaders;
+    Model &planet, &rock;
+    Skybox &skybox;
+    glm::mat4 planetModel;
+    ClusteredLighting lighting;
+    ShadowMapArray shadowMaps;
+    ImpostorAtlas impostorAtlas;
+    // instanceMatrices holds the matrices, read by the ring shader as a storage buffer; the ring draws instance
+    // ids from allInstances (0..asteroids-1) or, with culling on, from the ids that passed the frustum test
+    unsigned int instanceMatrices = 0, allInstances = 0, visibleInstances = 0;
+    unsigned int asteroids = 0;
+    // far-field draws: a bare VAO whose only attribute is the instance id, and the ids drawn this frame
+    unsigned int impostorVAO = 0, impostorInstances = 0;
+    unsigned int shadowCasters[SHADOW_CASCADES] = {};
+};
+
+struct SceneStats {
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;
+    unsigned int asteroids = 0;
+    unsigned int impostors = 0;
+};
+
+// direction the sunlight travels for a sun at azimuth and elevation, in degrees
+glm::vec3 SunDirection(float azimuth, float elevation);
+
+// Simulation thread stages.
+// Frustum-visible asteroids go to `visible`, except those farther than impostorDistance (when it is
+// positive and the atlas baked), which go to `impostors`.
+void CullAsteroids(const AsteroidField &field, const glm::mat4 &projection, const glm::mat4 &view, float impostorDistance,
+                   std::vector<uint32_t> &visible, std::vector<uint32_t> &impostors);
+// Plans the cascades for this view and culls the casters of the dirty ones into casters[SHADOW_CASCADES].
+void PlanShadows(AsteroidField &field, const glm::mat4 &view, float zoom, float aspect, const glm::vec3 &sun, bool enabled,
+                 ShadowFrame &frame, std::vector<uint32_t> *casters);
+// One frame of simulation with the input taken since the last one; fills every field of packet.
+void SimulateFrame(SimulationState &state, const PendingInput &input, FramePacket &packet);
+
+// Render thread stages.
+// Position-only depth passes into the dirty cascades; the others keep what they were last rendered with.
+void RenderShadows(RenderState &state, const ShadowFrame &frame, const std::vector<uint32_t> *casters);
+// Draws every asteroid, or only the ids in `visible` when it is given, plus `impostors` as impostors.
+// The sky is off in benchmark runs, which keeps their numbers comparable with runs from before the skybox.
+SceneStats DrawScene(RenderState &state, const glm::mat4 &projection, const glm::mat4 &view, const std::vector<uint32_t> *visible,
+                     const std::vector<uint32_t> *impostors, const ShadowFrame &shadow, bool sky);
+
+#endif
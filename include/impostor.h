@@ -0,0 +1,32 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+class Model;
+class Shader;
+
+// Octahedral impostor atlas of one model (Ryan Brucks, "Octahedral impostors", 2018). The model is
+// rendered orthographically from GRID x GRID directions laid out on a full octahedral map into two
+// atlases: albedo with coverage in alpha, and object space normal with depth through the bounding sphere
+// in alpha. The far-field shader (impostorVertex.glsl) draws an instance as one camera-facing quad and
+// blends the four views nearest its view direction.
+class ImpostorAtlas {
+public:
+    // views per side; the shaders get it as the impostorGrid uniform
+    static const int GRID = 8;
+    static const int CELL_SIZE = 128;
+    static const int SIZE = GRID * CELL_SIZE;
+
+    // renders the atlases with bake (impostorBakeVertex/impostorBakeFrag), which has to have linked;
+    // radius bounds the model around its origin
+    bool Bake(Model &model, Shader &bake, float radius);
+    // sets the atlas uniforms of an impostor program that is in use and binds the atlases
+    void Apply(Shader &impostor) const;
+
+    bool Baked() const { return albedo != 0; }
+
+private:
+    unsigned int albedo = 0, normalDepth = 0;
+    float radius = 0.0f;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts unfinished jobs; a job submitted with a counter increments it and decrements it when done
+class JobCounter {
+public:
+    bool Pending() const { return count.load(std::memory_order_acquire) != 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> count{0};
+};
+
+// Work-stealing job system. Every worker owns a Chase–Lev deque (Chase and Lev 2005, with the memory
+// orders of Lê et al. 2013): it pushes and pops at the bottom while idle workers steal from the top.
+// Threads outside the pool submit through a shared queue. Wait() never blocks while there is work: the
+// waiting thread runs queued jobs itself until its counter drops to zero, so jobs may wait on jobs and
+// a pool with no workers still makes progress on the calling thread.
+class JobSystem {
+public:
+    // runs on `threads` threads counting the caller of Wait(), so it owns threads - 1 workers;
+    // threads == 0 uses std::thread::hardware_concurrency()
+    explicit JobSystem(unsigned int threads = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // the engine's shared pool, started on first use
+    static JobSystem &Instance();
+
+    void Run(std::function<void()> job, JobCounter *counter = nullptr);
+    // runs queued jobs on the calling thread until counter has no pending jobs
+    void Wait(const JobCounter &counter);
+
+    // fn(begin, end) over [0, count), split in halves down to at most `grain` items; idle workers steal the
+    // halves, so the split adapts to however many threads are free. Returns when every range has run.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn);
+    // fn(begin, end, slice) over `slices` equal slices of [0, count), for passes that keep per-slice state
+    // such as histograms; the slices run as jobs, so more slices than threads is fine
+    void ParallelSlices(unsigned int slices, size_t count, const std::function<void(size_t, size_t, unsigned int)> &fn);
+
+    // pool threads plus the waiting caller
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        JobCounter *counter;
+    };
+
+    // Fixed-capacity Chase–Lev deque; only the owner calls Push and Pop
+    class WorkDeque {
+    public:
+        static const int64_t CAPACITY = 4096;
+
+        bool Push(Job *job);
+        Job *Pop();
+        Job *Steal();
+
+    private:
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::atomic<Job *> slots[CAPACITY] = {};
+    };
+
+    void workerLoop(unsigned int index);
+    void enqueue(Job *job);
+    // own deque, then the shared queue, then the other workers; `self` is -1 outside the pool
+    Job *take(int self);
+    void execute(Job *job);
+    void splitRange(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &fn, JobCounter &counter);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkDeque>> deques;
+    std::mutex sharedMutex;
+    std::deque<Job *> shared;
+
+    // jobs queued anywhere; idle workers sleep on `wake` while it is zero
+    std::atomic<int64_t> queued{0};
+    std::atomic<unsigned int> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+};
+
+// A set of jobs with ordering constraints, run as a unit. A node is submitted once every node preceding
+// it has finished; nodes without predecessors start immediately. The constraints must not form a cycle.
+class JobGraph {
+public:
+    using Node = size_t;
+
+    Node Add(std::function<void()> fn);
+    // `after` starts only once `before` has finished
+    void Precede(Node before, Node after);
+    // submits the graph and helps run it until every node has finished; a graph can be run again
+    void Run(JobSystem &jobs);
+
+    size_t Size() const { return nodes.size(); }
+
+private:
+    struct GraphNode {
+        std::function<void()> fn;
+        std::vector<Node> successors;
+        uint32_t predecessors = 0;
+        std::atomic<uint32_t> remaining{0};
+    };
+
+    void submit(JobSystem &jobs, Node node, JobCounter &counter);
+
+    // a deque keeps nodes in place as the graph grows
+    std::deque<GraphNode> nodes;
+};
+
+#endif
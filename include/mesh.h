@@ -14,6 +14,8 @@ class Mesh {
         Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
         void Draw(Shader &shader);
         unsigned int VAO, VBO, EBO;
+        // positions alone, tightly packed and sharing EBO, for depth-only passes
+        unsigned int positionVAO, positionVBO;
         void setupMesh();
 };
 
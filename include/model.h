@@ -8,10 +8,12 @@
 #include "shader.h"
 #include "texture.h"
 #include "mesh.h"
+#include "objloader.h"
 
 class Model 
 {
     public:
+        Model() = default;
         Model(const char *path)
         {
             loadModel(path);
@@ -21,9 +23,12 @@ class Model
         std::string directory;
 
         void loadModel(std::string path);
+        void loadObj(const std::string &path);
         void processNode(aiNode *node, const aiScene *scene);
         Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+        Mesh processObjMesh(ObjMesh &mesh, const ObjScene &scene);
         std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+        Texture loadTexture(const std::string &path, const std::string &typeName);
 };
 
 #endif
\ No newline at end of file
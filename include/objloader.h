@@ -0,0 +1,33 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <string>
+#include <vector>
+#include "vertex.h"
+
+// Texture maps referenced by a `newmtl` block of a .mtl file
+struct ObjMaterial {
+    std::string name;
+    std::string diffuseMap;
+    std::string specularMap;
+};
+
+// One indexed mesh per `usemtl` run, ready to be handed to Mesh
+struct ObjMesh {
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    int material = -1;
+};
+
+struct ObjScene {
+    std::vector<ObjMesh>     meshes;
+    std::vector<ObjMaterial> materials;
+};
+
+// Native Wavefront OBJ/MTL loader. The file is split into line-aligned chunks that are parsed in parallel,
+// polygons are fan-triangulated and v/vt/vn triplets are deduplicated into indexed vertices.
+// Texture coordinates are flipped vertically to match aiProcess_FlipUVs.
+// Parsing and deduplication run as jobs on JobSystem::Instance(); threads == 0 uses every pool thread.
+bool LoadObj(const std::string &path, ObjScene &scene, unsigned int threads = 0);
+
+#endif
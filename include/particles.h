@@ -0,0 +1,92 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+class Shader;
+
+// A band around the y axis that spawns particles on circular orbits around the planet
+struct ParticleEmitter {
+    // particles per second
+    float rate = 0.0f;
+    float innerRadius = 0.0f, outerRadius = 0.0f;
+    // half the height of the band
+    float thickness = 0.0f;
+    // random velocity added to the orbit, relative to the orbit speed
+    float speedJitter = 0.0f;
+    // linear color, intensity in w
+    glm::vec4 color = glm::vec4(1.0f);
+    // seconds
+    float minLife = 1.0f, maxLife = 1.0f;
+    // world units
+    float minSize = 0.01f, maxSize = 0.01f;
+};
+
+struct ParticleParams {
+    // gravitational parameter of the planet; the orbit speed at radius r is sqrt(gravity / r)
+    float gravity = 112.5f;
+    // particles closer than this to the origin are removed
+    float planetRadius = 8.0f;
+    // fraction of the velocity lost per second
+    float drag = 0.0f;
+};
+
+// GPU particle system. Particles live in a storage buffer of Capacity() slots and are born, moved and
+// retired entirely by compute passes: a single-invocation kickoff pass clamps the frame's emission to the
+// free slots and writes the indirect dispatch sizes, the emit pass pops slots off a dead list with atomic
+// counters, and the simulate pass compacts the survivors into the alive list the renderer draws with one
+// indirect instanced draw. The CPU only turns emitter rates into a per-frame emission count.
+// Counts and the simulation's GPU time are read back FRAMES_IN_FLIGHT - 1 frames later without stalling.
+class ParticleSystem {
+public:
+    static const unsigned int MAX_EMITTERS = 16;
+    // matches local_size_x of particleEmit.glsl and particleSimulate.glsl
+    static const unsigned int WORKGROUP_SIZE = 256;
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+    explicit ParticleSystem(unsigned int capacity = 1u << 21, ParticleParams params = ParticleParams());
+
+    // drops every particle and reallocates for `capacity` slots on the next Simulate()
+    void SetCapacity(unsigned int capacity);
+    // emits for and advances the particles by deltaTime seconds; does nothing until the programs link
+    void Simulate(Shader &kickoff, Shader &emit, Shader &simulate, float deltaTime);
+    // draws the particles the last Simulate() left alive, additively and without writing depth
+    void Draw(Shader &render, const glm::mat4 &projection, const glm::mat4 &view);
+
+    // up to MAX_EMITTERS are used; may be edited between frames
+    std::vector<ParticleEmitter> &Emitters() { return emitters; }
+    ParticleParams &Params() { return params; }
+
+    unsigned int Capacity() const { return capacity; }
+    // as of the last frame read back
+    unsigned int Alive() const { return alive; }
+    unsigned int Emitted() const { return emitted; }
+    // GPU time of the kickoff, emit and simulate passes, -1 before the first result
+    double GpuMs() const { return gpuMs; }
+
+private:
+    void create();
+    void release();
+    // reads back the frame the slot about to be reused holds, if the GPU is done with it
+    void resolve(unsigned int slot);
+
+    unsigned int capacity;
+    ParticleParams params;
+    std::vector<ParticleEmitter> emitters;
+    // fractional particles owed to each emitter, carried over so low rates still emit
+    std::vector<float> emitCarry;
+    unsigned int list = 0;
+    unsigned int seed = 0;
+
+    unsigned int particleBuffer = 0, counterBuffer = 0, emitterBuffer = 0, listBuffer = 0;
+    unsigned int readbackBuffer = 0, emptyVAO = 0;
+    unsigned int queries[FRAMES_IN_FLIGHT] = {};
+    bool queryPending[FRAMES_IN_FLIGHT] = {};
+    unsigned int frame = 0;
+
+    unsigned int alive = 0, emitted = 0;
+    double gpuMs = -1.0;
+};
+
+#endif
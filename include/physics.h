@@ -0,0 +1,98 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "triplebuffer.h"
+
+namespace reactphysics3d {
+class PhysicsCommon;
+class PhysicsWorld;
+class RigidBody;
+class SphereShape;
+}
+
+struct PhysicsParams {
+    // seconds per physics step
+    float timeStep = 1.0f / 60.0f;
+    // gravitational parameter of the planet; asteroids start on circular orbits around the origin
+    float planetGM = 50.0f;
+    // random velocity added to the orbital one, and random spin, per axis
+    float velocityJitter = 0.05f;
+    float spinJitter = 0.5f;
+    float cameraRadius = 0.5f;
+};
+
+// Rigid-body simulation of asteroid instances with reactphysics3d. Each body gets a sphere collider from
+// its instance's bounding sphere and falls around the planet; a kinematic sphere follows the camera, so
+// the camera shoves asteroids aside and is itself pushed out of them.
+// The world steps at a fixed rate on its own thread. After every step the thread publishes the poses
+// before and after it through a TripleBuffer, and the simulation thread interpolates between the two at
+// its own frame time, one step behind the physics.
+class AsteroidPhysics {
+public:
+    explicit AsteroidPhysics(PhysicsParams params = PhysicsParams());
+    ~AsteroidPhysics();
+
+    // replaces the simulated bodies with one per transform (translation * scale * rotation, as FieldGenerator
+    // writes them), with sphere radius radii[i], and starts stepping
+    void Start(const std::vector<glm::mat4> &transforms, const std::vector<float> &radii);
+    void Stop();
+    bool Running() const { return thread.joinable(); }
+    // a paused world keeps its bodies but stops stepping
+    void SetPaused(bool paused) { this->paused = paused; }
+    bool Paused() const { return paused; }
+
+    // simulation thread: where the camera is now
+    void SetCamera(const glm::vec3 &position);
+    // simulation thread: writes every body's transform interpolated to the current time, and how far the
+    // camera has to move to get out of the asteroids it hit in steps not seen before, including steps whose
+    // frames were overwritten before they were read (zero when none). False before the first step.
+    bool Interpolate(std::vector<glm::mat4> &out, glm::vec3 &cameraPush);
+
+    size_t BodyCount() const { return scales.size(); }
+    // wall time of the last step
+    double StepMs() const { return stepMs; }
+
+private:
+    struct Pose {
+        glm::vec3 position;
+        glm::quat orientation;
+    };
+    struct Frame {
+        // seconds on the steady clock when `current` was produced
+        double time = 0.0;
+        std::vector<Pose> previous;
+        std::vector<Pose> current;
+        // sum of the camera pushes of every step so far; readers take the difference to the last one they saw
+        glm::dvec3 cameraPushTotal = glm::dvec3(0.0);
+    };
+
+    class ContactListener;
+
+    void run();
+    void applyGravity();
+
+    PhysicsParams params;
+    reactphysics3d::PhysicsCommon *common;
+    reactphysics3d::PhysicsWorld *world = nullptr;
+    std::vector<reactphysics3d::RigidBody *> bodies;
+    std::vector<reactphysics3d::SphereShape *> shapes;
+    reactphysics3d::RigidBody *cameraBody = nullptr;
+    ContactListener *listener = nullptr;
+    std::vector<float> scales;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{false};
+    std::atomic<double> stepMs{0.0};
+    TripleBuffer<Frame> frames;
+    TripleBuffer<glm::vec3> camera;
+    bool haveFrame = false;
+    glm::dvec3 consumedPush = glm::dvec3(0.0);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "bvh.h"
+#include "mesh.h"
+
+struct Ray {
+    glm::vec3 origin;
+    // normalized
+    glm::vec3 direction;
+};
+
+struct PickHit {
+    uint32_t instance;
+    uint32_t mesh;
+    // triangle index within the mesh
+    uint32_t triangle;
+    // along the ray, in world units
+    float distance;
+    glm::vec3 position;
+};
+
+// world-space ray through a cursor position given in window coordinates (origin top left)
+Ray ScreenRay(const glm::vec2 &cursor, const glm::vec2 &windowSize, const glm::mat4 &projection, const glm::mat4 &view);
+
+// A model's triangles as SoA vertex and edge arrays, padded to whole batches, for exact ray tests in model
+// space. Each batch of BATCH triangles runs Moller-Trumbore as plain per-lane loops the compiler vectorises.
+class MeshRaycaster {
+public:
+    static constexpr unsigned int BATCH = 8;
+
+    MeshRaycaster() = default;
+    explicit MeshRaycaster(const std::vector<Mesh> &meshes);
+
+    // nearest triangle (either facing) hit with t in (0, maxDistance); t is in units of `direction`, which
+    // need not be normalized. Returns the triangle index over all meshes.
+    bool Intersect(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, float &t, uint32_t &triangle) const;
+    // splits an index returned by Intersect into (mesh, triangle within it)
+    void Locate(uint32_t triangle, uint32_t &mesh, uint32_t &local) const;
+    uint32_t TriangleCount() const { return triangles; }
+
+private:
+    std::vector<float> v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z;
+    // first triangle of every mesh
+    std::vector<uint32_t> meshStart;
+    uint32_t triangles = 0;
+};
+
+// Nearest instance under `ray`: the BVH's ray query yields the instances whose bounding sphere the ray
+// crosses, which are then tested front to back against the mesh in instance space until the next sphere
+// starts beyond the closest triangle hit. instanceTransform(id) returns an instance's model matrix.
+bool PickInstance(const Ray &ray, const BVH &instances, const MeshRaycaster &mesh,
+                  const std::function<glm::mat4(uint32_t)> &instanceTransform, PickHit &hit, float maxDistance = 10000.0f);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One timed scope of a frame. Times are in milliseconds; CPU times count from profiler start, GPU times
+// from the frame's first GPU timestamp (negative when the zone has no GPU timing).
+struct ProfileZone {
+    const char *name;
+    uint32_t thread;
+    uint32_t depth;
+    int query;
+    double cpuStart, cpuEnd;
+    double gpuStart = -1.0, gpuEnd = -1.0;
+};
+
+struct ProfileFrame {
+    uint64_t index = 0;
+    double cpuStart = 0.0, cpuEnd = 0.0;
+    double gpuMs = -1.0;
+    std::vector<ProfileZone> zones;
+};
+
+// Frame profiler. CPU zones use steady_clock and may be opened on any thread; GPU zones bracket the scope
+// with glQueryCounter(GL_TIMESTAMP) pairs and must be opened on the GL thread. Queries are spread over
+// FRAMES_IN_FLIGHT sets and read back FRAMES_IN_FLIGHT - 1 frames later; a set whose results are still
+// not available is dropped rather than waited on, so the profiler never stalls the pipeline.
+class Profiler {
+public:
+    static const unsigned int FRAMES_IN_FLIGHT = 3;
+    static const unsigned int HISTORY = 240;
+
+    static Profiler &Instance();
+
+    void BeginFrame();
+    void EndFrame();
+    // records the next `frames` completed frames and writes them to `path` in Chrome trace-event format
+    // (load in chrome://tracing or ui.perfetto.dev)
+    void CaptureTrace(const std::string &path, unsigned int frames);
+    bool Capturing() const { return captureRemaining > 0; }
+    // "Profiler" window with rolling CPU/GPU graphs and a per-zone table
+    void DrawImGui();
+
+    double CpuFrameMs() const { return lastCpuMs; }
+    double GpuFrameMs() const { return lastGpuMs; }
+
+    // used by ProfileScope
+    double Now() const;
+    int BeginGpuQuery();
+    void EndGpuQuery(int query);
+    void Record(const ProfileZone &zone);
+
+private:
+    struct QuerySet {
+        ProfileFrame frame;
+        std::vector<unsigned int> queries;
+        unsigned int used = 0;
+        bool inFlight = false;
+    };
+    struct ZoneHistory {
+        float cpu[HISTORY] = {};
+        float gpu[HISTORY] = {};
+        bool hasGpu = false;
+    };
+
+    Profiler();
+    // reads back a set submitted FRAMES_IN_FLIGHT frames ago, if the GPU is done with it
+    void resolve(QuerySet &set);
+    void addHistory(const ProfileFrame &frame);
+    void writeTrace() const;
+
+    QuerySet sets[FRAMES_IN_FLIGHT];
+    QuerySet *current = nullptr;
+    uint64_t frameIndex = 0;
+    std::mutex mutex;
+
+    std::map<std::string, ZoneHistory> zones;
+    float cpuHistory[HISTORY] = {};
+    float gpuHistory[HISTORY] = {};
+    unsigned int historyOffset = 0;
+    double lastCpuMs = 0.0, lastGpuMs = 0.0;
+
+    std::string capturePath;
+    unsigned int captureRemaining = 0;
+    std::vector<ProfileFrame> captured;
+};
+
+// Times the enclosing scope on the CPU and, for GPU scopes, on the GPU
+class ProfileScope {
+public:
+    ProfileScope(const char *name, bool gpu);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+private:
+    ProfileZone zone;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// CPU and GPU timing; GL thread only
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+// CPU timing only; any thread
+#define PROFILE_CPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of every stage source plus the driver vendor, renderer and version strings,
+// so a driver update or an edited shader simply misses instead of loading a stale binary.
+class ProgramCache {
+public:
+    static ProgramCache &Instance();
+
+    // sources holds the final text of every stage, in attach order
+    uint64_t Key(const std::vector<std::string> &sources);
+    // tries to restore program from the cache; a binary the driver rejects is deleted and reported as a miss
+    bool Load(uint64_t key, unsigned int program);
+    // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void Store(uint64_t key, unsigned int program);
+    bool Enabled();
+
+    unsigned int Hits() const { return hits; }
+    unsigned int Misses() const { return misses; }
+
+private:
+    ProgramCache();
+    std::string entryPath(uint64_t key) const;
+
+    std::string directory;
+    std::string driver;
+    int supported = -1;
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+};
+
+#endif
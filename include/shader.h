@@ -3,25 +3,136 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
+// A preprocessed stage. When a SPIR-V build of the same file and defines is embedded (SHADER_SPIRV) and the
+// driver has GL_ARB_gl_spirv, `binary` points at it and `source` is only used for the cache key.
+struct ShaderStage {
+    GLenum type;
+    std::string source;
+    const unsigned char *binary = nullptr;
+    size_t binarySize = 0;
+    // specialization constants replacing defines that have no binary of their own
+    std::vector<GLuint> specIndices;
+    std::vector<GLuint> specValues;
+};
+
+// Stage files plus the permutation defines ("INSTANCED", "NAME=VALUE") a program variant is built with.
+// A compute program sets only `compute`.
+struct ShaderProgramDesc {
+    std::string vertex;
+    std::string geometry;
+    std::string fragment;
+    std::vector<std::string> defines;
+    std::string compute;
+
+    // runs every stage through PreprocessShader, reading from `directory` instead of the original location when set
+    bool Preprocess(const std::string &directory, std::vector<ShaderStage> &stages, std::vector<std::string> &dependencies) const;
+};
+
+// Programs are compiled asynchronously: the constructor only submits the compile and link, and status is
+// queried once the driver reports completion (GL_KHR_parallel_shader_compile). Until the first version
+// links Use() binds a flat placeholder program so frames never block on the driver. Reloads compile into
+// a second program that replaces the live one only once it links.
 class Shader {
 private:
-    unsigned int ID;
+    unsigned int ID = 0;
+    unsigned int pendingProgram = 0;
+    std::vector<unsigned int> pendingShaders;
+    std::vector<GLenum> pendingTypes;
+    ShaderProgramDesc desc;
+    std::vector<std::string> dependencies;
+    // variant whose program this one draws with while it has none of its own, because their preprocessed
+    // sources hash the same (sourceHash)
+    Shader *shared = nullptr;
+    uint64_t sourceHash = 0;
+    uint64_t cacheKey = 0;
+    bool pending = false;
+    bool pendingSpirv = false;
+    // SPIR-V programs may have no uniform names, so locations fall back to the reflection header
+    bool spirv = false;
+    std::chrono::steady_clock::time_point submitTime;
+    // preprocesses the stage files, from `directory` instead of their original location when it is not empty
+    bool load(const std::string &directory);
+    // submits compile and link of the stages, or restores the program from the on-disk binary cache
+    void build(const std::vector<ShaderStage> &stages);
+    // queries compile/link status of a submitted program and releases its shader objects
+    void finish();
+    // makes the pending program live
+    void swap();
+    unsigned int program() const;
+    int location(const std::string &name) const;
 public:
     Shader(const char* vertexPath, const char* fragmentPath);
     Shader(const char* vertexPath, const char *geometryPath, const char* fragmentPath);
+    explicit Shader(ShaderProgramDesc desc);
+    // takes stages that were already preprocessed from desc
+    Shader(ShaderProgramDesc desc, const std::vector<ShaderStage> &stages, std::vector<std::string> dependencies);
+    // a variant whose preprocessed stages came out identical to program's; it uses program's program until a
+    // reload makes its own sources differ, and then builds one of its own
+    Shader(ShaderProgramDesc desc, Shader &program, std::vector<std::string> dependencies);
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    // lets the driver use as many compiler threads as it likes; call once before submitting programs
+    static void EnableParallelCompile();
+    // non-blocking when parallel compile is supported, otherwise always true
+    bool IsReady() const;
+    // finishes the program if the driver is done with it; returns true once the program is usable
+    bool Poll();
+    bool IsPending() const { return pending; }
+    // hash of the preprocessed stage sources, equal for variants that compile to the same program
+    static uint64_t HashSources(const std::vector<ShaderStage> &stages);
+    uint64_t SourceHash() const { return sourceHash; }
+    bool SharesProgram() const { return shared && !ID; }
+    // recompiles from the stage files without blocking; the current program stays live until the new one links
+    bool Reload(const std::string &directory = "");
+    // true if any stage or file it includes has this file name
+    bool UsesFile(const std::string &name) const;
+    const ShaderProgramDesc &Desc() const { return desc; }
     void Use();
     void SetBool(const std::string &name, bool value) const;
     void SetInt(const std::string &name, int value) const;
+    void SetUInt(const std::string &name, unsigned int value) const;
     void SetFloat(const std::string &name, float value) const;
     void SetMat4(const std::string &name, glm::mat4 value) const;
+    // an array uniform starting at element 0
+    void SetMat4Array(const std::string &name, const glm::mat4 *values, int count) const;
+    void SetVec2(const std::string &name, glm::vec2 value) const;
+    void SetIVec2(const std::string &name, glm::ivec2 value) const;
     void SetVec3(const std::string &name, glm::vec3 value) const;
     void SetVec3(const std::string &name, float x, float y, float z) const;
+    void SetVec4(const std::string &name, glm::vec4 value) const;
+    void SetUVec3(const std::string &name, glm::uvec3 value) const;
     unsigned int GetId() const;
 };
 
+// Owns every program variant. Variants are keyed by stage files plus the sorted define set and built on
+// first request; variants whose preprocessed sources come out identical share one program. Each variant
+// is still its own Shader with its own defines, so a reload that makes their sources differ splits them.
+// All programs are submitted up front and finalised as the driver completes them.
+class ShaderLibrary {
+private:
+    std::vector<std::unique_ptr<Shader>> shaders;
+    std::unordered_map<std::string, Shader *> variants;
+    std::unordered_map<uint64_t, Shader *> programs;
+public:
+    ShaderLibrary();
+    Shader &Get(ShaderProgramDesc desc);
+    Shader &Get(const std::string &vertexPath, const std::string &fragmentPath, std::vector<std::string> defines = {});
+    Shader &GetCompute(const std::string &computePath, std::vector<std::string> defines = {});
+    // returns the number of programs still compiling
+    size_t Poll();
+    // every variant, for registering with a ShaderWatcher; programs are reloaded before the variants sharing them
+    const std::vector<std::unique_ptr<Shader>> &Programs() const { return shaders; }
+    size_t VariantCount() const { return variants.size(); }
+    size_t ProgramCount() const;
+};
+
 #endif //OPENGL_SHADER_H
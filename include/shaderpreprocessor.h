@@ -0,0 +1,25 @@
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include <string>
+#include <vector>
+
+// Front end run on every GLSL stage before it reaches the driver. Files are looked up by name in the
+// sources embedded at build time (shaders_embedded.h); a disk override directory, when set, takes
+// precedence for every file it holds.
+//  - `#include "file.glsl"` is resolved relative to the including file, each file at most once per stage
+//  - `defines` ("NAME" or "NAME=VALUE") are injected right after the #version line, skipping names the
+//    stage never mentions so that irrelevant permutations hash identically
+//  - #line directives keep driver error messages pointing at the original file and line; the source
+//    string number is the file's index in `dependencies`
+// Returns false if a file cannot be read or includes form a cycle. `applied`, when given, receives the defines
+// that were actually injected.
+bool PreprocessShader(const std::string &path, const std::vector<std::string> &defines, std::string &output,
+                      std::vector<std::string> &dependencies, std::vector<std::string> *applied = nullptr);
+
+// Development override: read shaders from this directory, falling back to the embedded copy of any file it
+// lacks or that cannot be opened (empty to disable)
+void SetShaderSourceOverride(const std::string &directory);
+const std::string &ShaderSourceOverride();
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shader.h"
+
+// Watches a shader directory with inotify on a background thread. Update() runs on the GL thread and
+// submits a non-blocking recompile for every registered program that uses one of the changed files.
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(const std::string &directory);
+    ~ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    void Watch(Shader &shader);
+    // also covers variants the library compiles after this call
+    void Watch(ShaderLibrary &library);
+    // returns the number of programs resubmitted this call
+    size_t Update();
+    const std::string &Directory() const { return directory; }
+
+private:
+    void run();
+
+    std::string directory;
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    std::vector<std::string> changed;
+    std::vector<Shader *> shaders;
+    std::vector<ShaderLibrary *> libraries;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SHADOWCASCADES_H
+#define SHADOWCASCADES_H
+
+#include <glm/glm.hpp>
+
+// matches SHADOW_CASCADES in shaders/shadows.glsl
+constexpr unsigned int SHADOW_CASCADES = 4;
+constexpr int SHADOW_MAP_RESOLUTION = 2048;
+
+struct ShadowCascade {
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    // view depth where the cascade hands over to the next one; 0 leaves it unused
+    float splitDepth = 0.0f;
+    // world size of one shadow map texel, for normal offset biasing
+    float texelSize = 0.0f;
+    // the map has to be re-rendered this frame; otherwise it still holds this matrix's depths
+    bool dirty = false;
+};
+
+// One frame's cascades, planned with the frame's camera and consumed by the shadow and forward passes
+struct ShadowFrame {
+    // direction the sunlight travels
+    glm::vec3 sunDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    ShadowCascade cascades[SHADOW_CASCADES];
+};
+
+struct ShadowParams {
+    // view depth the cascades cover
+    float distance = 300.0f;
+    // split placement, from uniform (0) to logarithmic (1)
+    float splitLambda = 0.75f;
+    // how far toward the sun casters outside a cascade's bounds still land in its map
+    float casterDistance = 150.0f;
+    // cached cascades are fitted this much larger than their slice (relative to its radius), so the camera
+    // can move within the margin before they are re-rendered
+    float cacheMargin = 0.15f;
+    bool cacheFarCascades = true;
+    // cosine between sun directions below which cached cascades are re-rendered
+    float sunThreshold = 0.99995f;
+};
+
+// Fits the cascades of a directional light to the view frustum (CPU only, call from one thread). Each
+// cascade bounds its frustum slice with a sphere, so its extent does not change as the camera turns, and
+// snaps the sphere's centre to whole shadow map texels, so static shadows do not crawl as it moves.
+// Cascades from FIRST_CACHED on are cached: they keep the matrix, and the map, they were last rendered with
+// until their slice leaves the enlarged sphere they were fitted to or the sun moves. Casters that move on
+// their own show up in a cached cascade at its next re-render.
+class CascadedShadows {
+public:
+    static const unsigned int FIRST_CACHED = 2;
+
+    explicit CascadedShadows(ShadowParams params = ShadowParams());
+
+    // plans the cascades for a perspective camera with this view matrix, vertical fov (radians) and aspect
+    void Plan(const glm::mat4 &view, float fovY, float aspect, float nearPlane, const glm::vec3 &sunDirection, ShadowFrame &out);
+    // every cascade is re-rendered next frame, e.g. after the casters changed
+    void Invalidate() { cacheValid = false; }
+    // turns the cascades off: the frame gets no splits, so the forward pass sees everything as lit
+    void Disable(const glm::vec3 &sunDirection, ShadowFrame &out);
+
+    ShadowParams &Params() { return params; }
+
+private:
+    // light view projection of a sphere; texelSize receives the world size of a texel
+    glm::mat4 fit(const glm::vec3 &center, float radius, const glm::vec3 &sunDirection, float &texelSize) const;
+
+    ShadowParams params;
+    bool cacheValid = false;
+    glm::vec3 cachedSun = glm::vec3(0.0f);
+    // centre and radius each cached cascade was fitted to
+    glm::vec4 cachedSphere[SHADOW_CASCADES];
+    ShadowCascade cached[SHADOW_CASCADES];
+};
+
+class Shader;
+
+// Depth texture array holding one layer per cascade, rendered with a depth-only framebuffer
+class ShadowMapArray {
+public:
+    // binds cascade's layer as the depth target and clears it; the first call saves the framebuffer and viewport
+    void Begin(unsigned int cascade);
+    // restores what the first Begin() saved
+    void End();
+    // sets the cascade uniforms of a CASCADED_SHADOWS program that is in use and binds the maps
+    void Apply(Shader &forward, const ShadowFrame &frame);
+
+private:
+    void create();
+
+    unsigned int texture = 0, framebuffer = 0;
+    bool active = false;
+    int savedFramebuffer = 0;
+    int savedViewport[4] = {};
+};
+
+#endif
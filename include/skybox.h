@@ -0,0 +1,62 @@
+#ifndef SKYBOX_H
+#define SKYBOX_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jobsystem.h"
+
+class Shader;
+
+// Cubemap sky drawn after the opaque scene. Load() decodes the six faces on the job system while the caller
+// goes on (loading models, say) and Finish() uploads them into immutable storage with a full mip chain.
+// With a cooked path the faces are kept BC1 (S3TC DXT1) compressed: the first run has the driver compress
+// the decoded faces and writes the blocks there, and later runs read the blocks back instead of decoding
+// JPEGs. A cooked file is keyed by the size and modification time of every face, so edited faces re-cook.
+class Skybox {
+public:
+    // file names of the +X, -X, +Y, -Y, +Z and -Z faces
+    static const char *const FACES[6];
+
+    ~Skybox();
+
+    // starts reading directory/FACES (or the cooked file, when it is up to date) on the job system
+    void Load(const std::string &directory, const std::string &cookedPath = "");
+    // waits for Load() and creates the cubemap; GL thread only
+    bool Finish();
+    // draws the sky behind everything already in the depth buffer; the depth test must pass equal depths
+    void Draw(Shader &skybox, const glm::mat4 &projection, const glm::mat4 &view);
+
+    bool Loaded() const { return texture != 0; }
+    bool Compressed() const { return compressed; }
+
+private:
+    // one face of one mip level; pixels is stbi memory for decoded faces, blocks holds compressed ones
+    struct Image {
+        int size = 0;
+        unsigned char *pixels = nullptr;
+        std::vector<unsigned char> blocks;
+    };
+
+    uint64_t sourceKey() const;
+    bool readCooked();
+    void writeCooked() const;
+    void decodeFace(unsigned int face);
+    void createCompressed();
+    void createUncompressed();
+    void cook();
+    void releaseImages();
+
+    std::string directory, cookedPath;
+    JobCounter loading;
+    bool fromCooked = false;
+    int size = 0, levels = 0;
+    // FACES order within a level, levels in order
+    std::vector<Image> images;
+    unsigned int texture = 0, cubeVAO = 0, cubeVBO = 0;
+    bool compressed = false;
+};
+
+#endif
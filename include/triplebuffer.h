@@ -0,0 +1,37 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer hand-off of the latest value. The writer fills Back() and
+// Publish()es it; the reader calls Update() and then reads Front(). The third slot sits between them, so
+// neither side ever waits for the other and the reader always sees a complete value. Values published
+// faster than they are read are overwritten; Back() keeps whatever an earlier publish left in that slot.
+template<typename T>
+class TripleBuffer {
+public:
+    T &Back() { return buffers[back]; }
+    void Publish() {
+        back = middle.exchange(back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // swaps in the most recently published value; false when nothing new was published since the last call
+    bool Update() {
+        if(!(middle.load(std::memory_order_relaxed) & DIRTY))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T &Front() const { return buffers[front]; }
+
+private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int DIRTY = 4;
+
+    T buffers[3];
+    unsigned int back = 0;
+    std::atomic<unsigned int> middle{1};
+    unsigned int front = 2;
+};
+
+#endif
@@ -0,0 +1,31 @@
+// Clustered light lists, shared by the light culling compute shader and the forward pass. The view frustum
+// is cut into clusterGrid.x * clusterGrid.y screen tiles and clusterGrid.z depth slices spaced exponentially
+// between clusterDepthRange.x and .y; cluster c lists its lights in clusterIndices[c * MAX_CLUSTER_LIGHTS + i]
+// for i below clusterCounts[c].
+// MAX_CLUSTER_LIGHTS must match ClusteredLighting::MAX_LIGHTS_PER_CLUSTER; lights past it are dropped and counted.
+const uint MAX_CLUSTER_LIGHTS = 128u;
+
+// world space position and range, linear color and intensity
+struct PointLight {
+    vec4 positionRange;
+    vec4 colorIntensity;
+};
+
+layout (std430, binding = 1) readonly buffer PointLights {
+    PointLight lights[];
+};
+layout (std430, binding = 2) buffer ClusterLightCounts {
+    uint clusterCounts[];
+};
+layout (std430, binding = 3) buffer ClusterLightIndices {
+    uint clusterIndices[];
+};
+
+layout (location = 20) uniform uvec3 clusterGrid;
+layout (location = 21) uniform vec2 clusterDepthRange;
+
+// depth slice of a view space distance in front of the camera
+uint clusterSlice(float depth) {
+    float slice = log(max(depth, clusterDepthRange.x) / clusterDepthRange.x) / log(clusterDepthRange.y / clusterDepthRange.x);
+    return min(uint(slice * float(clusterGrid.z)), clusterGrid.z - 1u);
+}
@@ -1,11 +1,72 @@
-#version 330 core
-out vec4 FragColor;
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+layout (location = 0) out vec4 FragColor;
 
-in vec2 TexCoords;
+layout (location = 0) in vec2 TexCoords;
 
-uniform sampler2D texture_diffuse1;
+layout (location = 8, binding = 0) uniform sampler2D texture_diffuse1;
+
+// SPIR-V builds select alpha testing with a specialization constant instead of a separate binary
+#ifdef GL_SPIRV
+layout (constant_id = 0) const bool alphaTest = false;
+#elif defined(ALPHA_TEST)
+const bool alphaTest = true;
+#else
+const bool alphaTest = false;
+#endif
+layout (location = 9) uniform float alphaCutoff = 0.5;
+
+#if defined(CLUSTERED_LIGHTING) || defined(CASCADED_SHADOWS)
+layout (location = 1) in vec3 WorldPos;
+layout (location = 2) in vec3 WorldNormal;
+layout (location = 3) in float ViewDepth;
+#endif
+
+#ifdef CASCADED_SHADOWS
+#include "shadows.glsl"
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+#include "clusters.glsl"
+
+// clusterGrid.xy / viewport size in pixels
+layout (location = 22) uniform vec2 clusterTileScale;
+
+// diffuse light from the point lights binned into this fragment's cluster, with a windowed inverse square
+// falloff that reaches zero at each light's range
+vec3 clusteredLighting() {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterTileScale), clusterGrid.xy - 1u);
+    uint cluster = tile.x + clusterGrid.x * (tile.y + clusterGrid.y * clusterSlice(ViewDepth));
+    uint count = clusterCounts[cluster];
+    vec3 normal = normalize(WorldNormal);
+    vec3 light = vec3(0.0);
+    for(uint i = 0u; i < count; i++) {
+        PointLight pointLight = lights[clusterIndices[cluster * MAX_CLUSTER_LIGHTS + i]];
+        vec3 toLight = pointLight.positionRange.xyz - WorldPos;
+        float distanceSquared = dot(toLight, toLight);
+        float window = clamp(1.0 - pow(distanceSquared / (pointLight.positionRange.w * pointLight.positionRange.w), 2.0), 0.0, 1.0);
+        float attenuation = window * window / (distanceSquared + 1.0);
+        float lambert = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-6))), 0.0);
+        light += pointLight.colorIntensity.rgb * (pointLight.colorIntensity.a * lambert * attenuation);
+    }
+    return light;
+}
+#endif
 
 void main()
 {
     FragColor = texture(texture_diffuse1, TexCoords);
-}
\ No newline at end of file
+    if(alphaTest && FragColor.a < alphaCutoff)
+        discard;
+    // without the sun the unlit texture is the ambient term
+    vec3 light = vec3(1.0);
+#ifdef CASCADED_SHADOWS
+    light = sunLighting(WorldPos, normalize(WorldNormal), ViewDepth);
+#endif
+#ifdef CLUSTERED_LIGHTING
+    light += clusteredLighting();
+#endif
+    FragColor.rgb *= light;
+}
@@ -0,0 +1,34 @@
+// Octahedral impostor layout shared by the baker and the far-field pass. View (i, j) of the impostorGrid x
+// impostorGrid atlas looks at the model's origin from impostorDirection(i, j), a vertex of the full
+// octahedral map (asteroids tumble, so every direction gets seen), and its image spans impostorRadius
+// around the origin in the impostorBasis() plane.
+layout (location = 40) uniform int impostorGrid;
+layout (location = 41) uniform float impostorRadius;
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octahedralEncode(vec3 direction) {
+    direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+    return direction.z >= 0.0 ? direction.xy : (1.0 - abs(direction.yx)) * signNotZero(direction.xy);
+}
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if(direction.z < 0.0)
+        direction.xy = (1.0 - abs(direction.yx)) * signNotZero(direction.xy);
+    return normalize(direction);
+}
+
+// direction from the model towards the viewer of view `cell`
+vec3 impostorDirection(vec2 cell) {
+    return octahedralDecode(cell / float(impostorGrid - 1) * 2.0 - 1.0);
+}
+
+// image axes of the view looking back at the origin from `direction`
+void impostorBasis(vec3 direction, out vec3 right, out vec3 up) {
+    vec3 reference = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(reference, direction));
+    up = cross(direction, right);
+}
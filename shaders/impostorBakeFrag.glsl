@@ -0,0 +1,15 @@
+#version 460 core
+// Albedo with coverage in alpha, and the object space normal with the baked depth
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalDepth;
+
+layout (location = 0) in vec2 TexCoords;
+layout (location = 1) in vec3 Normal;
+layout (location = 2) in float Depth;
+
+layout (location = 8, binding = 0) uniform sampler2D texture_diffuse1;
+
+void main() {
+    Albedo = vec4(texture(texture_diffuse1, TexCoords).rgb, 1.0);
+    NormalDepth = vec4(normalize(Normal) * 0.5 + 0.5, Depth);
+}
@@ -0,0 +1,30 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Renders the model into one atlas cell: an orthographic view along -impostorDirection(impostorCell)
+// covering impostorRadius around the origin.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+#include "impostor.glsl"
+
+layout (location = 42) uniform ivec2 impostorCell;
+
+layout (location = 0) out vec2 TexCoords;
+layout (location = 1) out vec3 Normal;
+layout (location = 2) out float Depth;
+
+void main() {
+    vec3 direction = impostorDirection(vec2(impostorCell));
+    vec3 right, up;
+    impostorBasis(direction, right, up);
+    vec3 position = aPos / impostorRadius;
+    float toward = dot(position, direction);
+    gl_Position = vec4(dot(position, right), dot(position, up), -toward, 1.0);
+    TexCoords = aTexCoords;
+    Normal = aNormal;
+    // 1 at the front of the bounding sphere, 0 at its back
+    Depth = toward * 0.5 + 0.5;
+}
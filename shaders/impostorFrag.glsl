@@ -0,0 +1,59 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+layout (location = 0) out vec4 FragColor;
+// the quad is the nearest the surface can be, so the depth written only ever grows
+layout (depth_greater) out float gl_FragDepth;
+
+layout (location = 0) in vec2 FrameUV[4];
+layout (location = 4) flat in vec4 FrameWeights;
+layout (location = 5) flat in ivec4 FrameCells;
+layout (location = 6) flat in mat3 Rotation;
+layout (location = 9) in vec3 WorldPos;
+layout (location = 10) flat in vec3 ToCamera;
+layout (location = 11) flat in float Radius;
+
+layout (location = 0) uniform mat4 projection;
+layout (location = 1) uniform mat4 view;
+layout (location = 40) uniform int impostorGrid;
+
+layout (location = 44, binding = 0) uniform sampler2D impostorAlbedo;
+layout (location = 45, binding = 1) uniform sampler2D impostorNormalDepth;
+
+#ifdef CASCADED_SHADOWS
+#include "shadows.glsl"
+#endif
+
+void main() {
+    vec3 color = vec3(0.0);
+    vec4 normalDepth = vec4(0.0);
+    float coverage = 0.0;
+    // half a texel in from the cell edges so filtering never reads the neighbouring view
+    vec2 inset = 0.5 / vec2(textureSize(impostorAlbedo, 0)) * float(impostorGrid);
+    for(int i = 0; i < 4; i++) {
+        vec2 cell = vec2(FrameCells[i] % impostorGrid, FrameCells[i] / impostorGrid);
+        vec2 uv = (cell + clamp(FrameUV[i], inset, 1.0 - inset)) / float(impostorGrid);
+        vec4 albedo = texture(impostorAlbedo, uv);
+        float weight = FrameWeights[i] * albedo.a;
+        color += albedo.rgb * weight;
+        normalDepth += texture(impostorNormalDepth, uv) * weight;
+        coverage += weight;
+    }
+    if(coverage < 0.5)
+        discard;
+    color /= coverage;
+    normalDepth /= coverage;
+
+    vec3 normal = normalize(Rotation * (normalDepth.xyz * 2.0 - 1.0));
+    vec3 surface = WorldPos + ToCamera * ((normalDepth.w * 2.0 - 1.0) * Radius);
+    vec4 clip = projection * view * vec4(surface, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // point lights have short ranges next to the impostor distance, so only the sun lights the far field
+    vec3 light = vec3(1.0);
+#ifdef CASCADED_SHADOWS
+    light = sunLighting(surface, normal, -(view * vec4(surface, 1.0)).z);
+#endif
+    FragColor = vec4(color * light, 1.0);
+}
@@ -0,0 +1,62 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Far-field asteroids as octahedral impostors: four vertices per instance, generated from gl_VertexID as
+// a triangle strip. The quad faces the camera from the front of the instance's bounding sphere; each
+// corner is projected into the four baked views nearest the view direction, which the fragment shader
+// blends bilinearly.
+#include "instance.glsl"
+#include "impostor.glsl"
+
+layout (location = 0) uniform mat4 projection;
+layout (location = 1) uniform mat4 view;
+layout (location = 43) uniform vec3 cameraPosition;
+
+// position in the image of each blended view, 0..1 inside its cell
+layout (location = 0) out vec2 FrameUV[4];
+layout (location = 4) flat out vec4 FrameWeights;
+layout (location = 5) flat out ivec4 FrameCells;
+layout (location = 6) flat out mat3 Rotation;
+// point on the plane through the centre facing the camera
+layout (location = 9) out vec3 WorldPos;
+layout (location = 10) flat out vec3 ToCamera;
+layout (location = 11) flat out float Radius;
+
+void main() {
+    mat4 world = instanceTransform();
+    vec3 center = world[3].xyz;
+    float scale = length(world[0].xyz);
+    mat3 rotation = mat3(world) / scale;
+    float radius = impostorRadius * scale;
+
+    float distance = length(cameraPosition - center);
+    vec3 toCamera = (cameraPosition - center) / distance;
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 right = normalize(cross(cameraUp, toCamera));
+    vec3 up = cross(toCamera, right);
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec3 offset = (right * corner.x + up * corner.y) * radius;
+
+    // far away the views are close to orthographic, so the offset projects straight into each view plane
+    vec3 objectOffset = transpose(rotation) * offset / scale;
+    vec2 grid = (octahedralEncode(transpose(rotation) * toCamera) * 0.5 + 0.5) * float(impostorGrid - 1);
+    vec2 base = min(floor(grid), vec2(impostorGrid - 2));
+    vec2 blend = grid - base;
+    FrameWeights = vec4((1.0 - blend.x) * (1.0 - blend.y), blend.x * (1.0 - blend.y), (1.0 - blend.x) * blend.y, blend.x * blend.y);
+    for(int i = 0; i < 4; i++) {
+        vec2 cell = base + vec2(i & 1, i >> 1);
+        vec3 frameRight, frameUp;
+        impostorBasis(impostorDirection(cell), frameRight, frameUp);
+        FrameUV[i] = vec2(dot(objectOffset, frameRight), dot(objectOffset, frameUp)) / impostorRadius * 0.5 + 0.5;
+        FrameCells[i] = int(cell.x) + int(cell.y) * impostorGrid;
+    }
+
+    Rotation = rotation;
+    ToCamera = toCamera;
+    Radius = radius;
+    WorldPos = center + offset;
+    // pulled in towards the camera along the view ray, so the quad covers the same pixels it would at the centre
+    vec3 front = center + toCamera * radius + offset * ((distance - radius) / distance);
+    gl_Position = projection * view * vec4(front, 1.0);
+}
@@ -0,0 +1,45 @@
+// World transform of the vertex being shaded. INSTANCED reads a full matrix per instance,
+// QUANTIZED_INSTANCE a translation + uniform scale and a rotation quaternion (both normalized
+// integer attributes on the C++ side), INDEXED_INSTANCE a per-instance index into a storage buffer
+// of matrices (so a culled draw only uploads the visible ids), and plain draws use the model uniform.
+#if defined(QUANTIZED_INSTANCE)
+layout (location = 3) in vec4 instancePositionScale;
+layout (location = 4) in vec4 instanceRotation;
+
+layout (location = 3) uniform vec3 instanceBoundsMin;
+layout (location = 4) uniform vec3 instanceBoundsSize;
+
+mat4 instanceTransform() {
+    vec4 q = normalize(instanceRotation);
+    mat3 rotation = mat3(
+        1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y),
+        2.0 * (q.x * q.y - q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z + q.w * q.x),
+        2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+    vec3 position = instanceBoundsMin + instancePositionScale.xyz * instanceBoundsSize;
+    mat4 transform = mat4(rotation * instancePositionScale.w);
+    transform[3] = vec4(position, 1.0);
+    return transform;
+}
+#elif defined(INDEXED_INSTANCE)
+layout (location = 3) in uint instanceIndex;
+
+layout (std430, binding = 0) readonly buffer InstanceMatrices {
+    mat4 instanceMatrices[];
+};
+
+mat4 instanceTransform() {
+    return instanceMatrices[instanceIndex];
+}
+#elif defined(INSTANCED)
+layout (location = 3) in mat4 instanceMatrix;
+
+mat4 instanceTransform() {
+    return instanceMatrix;
+}
+#else
+layout (location = 2) uniform mat4 model;
+
+mat4 instanceTransform() {
+    return model;
+}
+#endif
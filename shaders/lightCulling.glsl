@@ -0,0 +1,77 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Bins point lights into the cluster grid, one invocation per cluster. Lights are moved to view space
+// cooperatively, a workgroup-sized batch at a time through shared memory, and every cluster tests the
+// batch against its view space bounding box. Clusters overlapped by more than MAX_CLUSTER_LIGHTS lights keep
+// the first ones and report the rest in ClusterOverflow.
+layout (local_size_x = 128) in;
+
+#include "clusters.glsl"
+
+// zeroed before every dispatch; clusters that ran out of room and the light references they dropped
+layout (std430, binding = 8) buffer ClusterOverflow {
+    uint overflowClusters;
+    uint droppedLights;
+};
+
+layout (location = 23) uniform mat4 view;
+layout (location = 24) uniform mat4 inverseProjection;
+layout (location = 25) uniform uint lightCount;
+
+shared vec4 batch[128];
+
+// view space point on the plane z = -depth along the ray through the NDC point
+vec3 viewPoint(vec2 ndc, float depth) {
+    vec4 point = inverseProjection * vec4(ndc, -1.0, 1.0);
+    point /= point.w;
+    return point.xyz * (depth / -point.z);
+}
+
+void main() {
+    uint cluster = gl_GlobalInvocationID.x;
+    uint clusterCount = clusterGrid.x * clusterGrid.y * clusterGrid.z;
+    bool inRange = cluster < clusterCount;
+
+    uvec3 cell = uvec3(cluster % clusterGrid.x, (cluster / clusterGrid.x) % clusterGrid.y, cluster / (clusterGrid.x * clusterGrid.y));
+    float ratio = clusterDepthRange.y / clusterDepthRange.x;
+    float nearDepth = clusterDepthRange.x * pow(ratio, float(cell.z) / float(clusterGrid.z));
+    float farDepth = clusterDepthRange.x * pow(ratio, float(cell.z + 1u) / float(clusterGrid.z));
+    vec2 ndcMin = vec2(cell.xy) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(cell.xy + 1u) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+    vec3 boundsMin = vec3(1e30), boundsMax = vec3(-1e30);
+    for(int corner = 0; corner < 4; corner++) {
+        vec2 ndc = vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x, (corner & 2) != 0 ? ndcMax.y : ndcMin.y);
+        vec3 nearPoint = viewPoint(ndc, nearDepth), farPoint = viewPoint(ndc, farDepth);
+        boundsMin = min(boundsMin, min(nearPoint, farPoint));
+        boundsMax = max(boundsMax, max(nearPoint, farPoint));
+    }
+
+    uint count = 0u, overlapping = 0u;
+    for(uint base = 0u; base < lightCount; base += gl_WorkGroupSize.x) {
+        uint index = base + gl_LocalInvocationIndex;
+        if(index < lightCount) {
+            vec4 light = lights[index].positionRange;
+            batch[gl_LocalInvocationIndex] = vec4((view * vec4(light.xyz, 1.0)).xyz, light.w);
+        }
+        barrier();
+        uint batchSize = min(gl_WorkGroupSize.x, lightCount - base);
+        for(uint i = 0u; inRange && i < batchSize; i++) {
+            vec4 light = batch[i];
+            vec3 outside = max(boundsMin - light.xyz, 0.0) + max(light.xyz - boundsMax, 0.0);
+            if(dot(outside, outside) > light.w * light.w)
+                continue;
+            if(count < MAX_CLUSTER_LIGHTS)
+                clusterIndices[cluster * MAX_CLUSTER_LIGHTS + count++] = base + i;
+            overlapping++;
+        }
+        barrier();
+    }
+    if(inRange)
+        clusterCounts[cluster] = count;
+    if(overlapping > count) {
+        atomicAdd(overflowClusters, 1u);
+        atomicAdd(droppedLights, overlapping - count);
+    }
+}
@@ -0,0 +1,60 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Spawns emitCount particles, one per invocation: each pops a slot off the dead list, places a particle in
+// its emitter's band on a circular orbit around the planet and appends the slot to the current alive list.
+layout (local_size_x = 256) in;
+
+#include "particles.glsl"
+
+layout (location = 53) uniform uint emitterCount;
+layout (location = 54) uniform uint particleSeed;
+// gravitational parameter of the planet: the circular orbit speed at radius r is sqrt(planetGravity / r)
+layout (location = 55) uniform float planetGravity;
+
+// PCG hash (Jarzynski and Olano 2020, "Hash functions for GPU rendering")
+uint pcgHash(uint value) {
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random(inout uint state) {
+    state = pcgHash(state);
+    return float(state >> 8u) / 16777216.0;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= emitCount)
+        return;
+    uint e = 0u;
+    while(e + 1u < emitterCount && i >= emitters[e].emission.x + emitters[e].emission.y)
+        e++;
+    ParticleEmitter emitter = emitters[e];
+
+    uint state = pcgHash(i ^ pcgHash(particleSeed));
+    float angle = random(state) * 6.2831853;
+    // uniform over the annulus area
+    float innerSquared = emitter.shape.x * emitter.shape.x;
+    float radius = sqrt(mix(innerSquared, emitter.shape.y * emitter.shape.y, random(state)));
+    float height = (random(state) * 2.0 - 1.0) * emitter.shape.z;
+    vec3 position = vec3(sin(angle) * radius, height, cos(angle) * radius);
+    vec3 tangent = vec3(cos(angle), 0.0, -sin(angle));
+    float speed = sqrt(planetGravity / radius);
+    vec3 jitter = vec3(random(state), random(state), random(state)) * 2.0 - 1.0;
+
+    Particle particle;
+    particle.position = position;
+    particle.velocity = tangent * speed + jitter * (speed * emitter.shape.w);
+    particle.age = 0.0;
+    particle.lifetime = mix(emitter.lifeSize.x, emitter.lifeSize.y, random(state));
+    particle.size = mix(emitter.lifeSize.z, emitter.lifeSize.w, random(state));
+    particle.color = emitter.color.rgb * emitter.color.a * mix(0.6, 1.0, random(state));
+
+    // the kickoff pass capped emitCount at deadCount, so the list cannot run dry
+    uint index = particleLists[atomicAdd(deadCount, 0xFFFFFFFFu) - 1u];
+    particles[index] = particle;
+    particleLists[aliveSlot(particleList, atomicAdd(aliveCount, 1u))] = index;
+}
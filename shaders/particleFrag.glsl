@@ -0,0 +1,11 @@
+#version 460 core
+// Soft round sprite, blended additively
+layout (location = 0) out vec4 FragColor;
+
+layout (location = 0) in vec2 Corner;
+layout (location = 1) flat in vec3 Color;
+
+void main() {
+    float falloff = max(1.0 - dot(Corner, Corner), 0.0);
+    FragColor = vec4(Color * falloff * falloff, 0.0);
+}
@@ -0,0 +1,27 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Turns last frame's survivors and this frame's emission request into the counts and indirect dispatch
+// sizes of the emit and simulate passes, so the CPU never reads a particle count back to size them.
+layout (local_size_x = 1) in;
+
+#include "particles.glsl"
+
+// must match ParticleSystem::WORKGROUP_SIZE and local_size_x of the emit and simulate passes
+const uint PARTICLE_GROUP = 256u;
+
+layout (location = 52) uniform uint emitRequest;
+
+void main() {
+    aliveCount = drawInstanceCount;
+    emitCount = min(emitRequest, deadCount);
+    emitGroupsX = (emitCount + PARTICLE_GROUP - 1u) / PARTICLE_GROUP;
+    emitGroupsY = 1u;
+    emitGroupsZ = 1u;
+    simulateGroupsX = (aliveCount + emitCount + PARTICLE_GROUP - 1u) / PARTICLE_GROUP;
+    simulateGroupsY = 1u;
+    simulateGroupsZ = 1u;
+    drawVertexCount = 4u;
+    drawInstanceCount = 0u;
+}
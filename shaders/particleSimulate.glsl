@@ -0,0 +1,41 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Advances every particle on the current alive list by particleDeltaTime under the planet's gravity.
+// Survivors go to the other alive list, which the renderer draws; expired particles and those that fell
+// into the planet return to the dead list.
+layout (local_size_x = 256) in;
+
+#include "particles.glsl"
+
+layout (location = 55) uniform float planetGravity;
+layout (location = 56) uniform float particleDeltaTime;
+// particles are killed inside this distance from the origin
+layout (location = 57) uniform float planetRadius;
+// fraction of the velocity lost per second
+layout (location = 58) uniform float particleDrag;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= aliveCount)
+        return;
+    uint index = particleLists[aliveSlot(particleList, i)];
+    Particle particle = particles[index];
+
+    particle.age += particleDeltaTime;
+    float distanceSquared = dot(particle.position, particle.position);
+    if(particle.age >= particle.lifetime || distanceSquared < planetRadius * planetRadius) {
+        particleLists[atomicAdd(deadCount, 1u)] = index;
+        return;
+    }
+    // semi-implicit Euler keeps the orbits closed over a particle's lifetime
+    vec3 acceleration = -planetGravity * particle.position * inversesqrt(distanceSquared) / distanceSquared;
+    particle.velocity = (particle.velocity + acceleration * particleDeltaTime) * max(1.0 - particleDrag * particleDeltaTime, 0.0);
+    particle.position += particle.velocity * particleDeltaTime;
+    particles[index].position = particle.position;
+    particles[index].velocity = particle.velocity;
+    particles[index].age = particle.age;
+
+    particleLists[aliveSlot(1u - particleList, atomicAdd(drawInstanceCount, 1u))] = index;
+}
@@ -0,0 +1,32 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Camera-facing quads, four vertices per particle from gl_VertexID as a triangle strip, one instance per
+// entry of the alive list the simulate pass just wrote. The instance count comes from that pass too.
+#include "particles.glsl"
+
+layout (location = 0) uniform mat4 projection;
+layout (location = 1) uniform mat4 view;
+// world size of a pixel at unit distance; quads never shrink below about a pixel and fade instead
+layout (location = 59) uniform float particlePixelSize;
+
+layout (location = 0) out vec2 Corner;
+layout (location = 1) flat out vec3 Color;
+
+void main() {
+    Particle particle = particles[particleLists[aliveSlot(particleList, gl_InstanceID)]];
+    vec4 viewPosition = view * vec4(particle.position, 1.0);
+    float minimumSize = -viewPosition.z * particlePixelSize;
+    float size = max(particle.size, minimumSize);
+    // fade in over the first tenth of the life and out over the last third
+    float life = particle.age / particle.lifetime;
+    float fade = smoothstep(0.0, 0.1, life) * (1.0 - smoothstep(0.67, 1.0, life));
+    // a quad enlarged to the minimum size keeps the brightness of the particle it stands for
+    float coverage = particle.size / size;
+    Color = particle.color * fade * coverage * coverage;
+
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    viewPosition.xy += Corner * size;
+    gl_Position = projection * viewPosition;
+}
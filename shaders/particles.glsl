@@ -0,0 +1,58 @@
+// GPU particle state, shared by the kickoff, emit and simulate compute passes and the particle renderer.
+// Every particle slot is either on the dead list or on one of the two alive lists. A frame's emit pass pops
+// dead slots onto the current alive list, and the simulate pass walks that list, appending survivors to the
+// other one and pushing expired particles back onto the dead list; the lists swap every frame.
+// Particle, ParticleEmitter and the counter block are mirrored in src/particles.cpp.
+
+// one orbiting particle, ages in seconds
+struct Particle {
+    vec3 position;
+    float size;
+    vec3 velocity;
+    float age;
+    vec3 color;
+    float lifetime;
+};
+
+// a band around the y axis particles spawn in; emission holds this frame's first emit index and count
+struct ParticleEmitter {
+    vec4 shape;
+    vec4 color;
+    vec4 lifeSize;
+    uvec4 emission;
+};
+
+layout (std430, binding = 4) buffer Particles {
+    Particle particles[];
+};
+
+// The first four words are a DrawArraysIndirectCommand and the next two triples the indirect dispatch sizes
+// of the emit and simulate passes. drawInstanceCount doubles as the survivor count of the simulate pass.
+layout (std430, binding = 5) buffer ParticleCounters {
+    uint drawVertexCount;
+    uint drawInstanceCount;
+    uint drawFirst;
+    uint drawBaseInstance;
+    uint emitGroupsX, emitGroupsY, emitGroupsZ;
+    uint simulateGroupsX, simulateGroupsY, simulateGroupsZ;
+    uint deadCount;
+    uint aliveCount;
+    uint emitCount;
+};
+
+layout (std430, binding = 6) readonly buffer ParticleEmitters {
+    ParticleEmitter emitters[];
+};
+
+// dead list in the first particleCapacity entries, then alive list 0 and alive list 1
+layout (std430, binding = 7) buffer ParticleLists {
+    uint particleLists[];
+};
+
+layout (location = 50) uniform uint particleCapacity;
+// alive list the emit pass appends to and the simulate pass reads
+layout (location = 51) uniform uint particleList;
+
+uint aliveSlot(uint list, uint i) {
+    return particleCapacity * (1u + list) + i;
+}
@@ -0,0 +1,15 @@
+#version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+// Depth-only pass into a shadow cascade. Meshes feed it from their position-only vertex arrays and the
+// program has no fragment stage.
+layout (location = 0) in vec3 aPos;
+
+#include "instance.glsl"
+
+layout (location = 0) uniform mat4 lightViewProjection;
+
+void main() {
+    gl_Position = lightViewProjection * instanceTransform() * vec4(aPos, 1.0);
+}
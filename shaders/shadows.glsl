@@ -0,0 +1,38 @@
+// Sun light with cascaded shadow maps, for the forward pass. Cascade i covers view depths up to
+// cascadeSplits[i]; past the last split everything is lit. SHADOW_CASCADES must match the C++ side.
+const uint SHADOW_CASCADES = 4u;
+
+layout (location = 30) uniform mat4 cascadeViewProjection[SHADOW_CASCADES];
+layout (location = 34) uniform vec4 cascadeSplits;
+// world size of a shadow map texel per cascade
+layout (location = 35) uniform vec4 cascadeTexelSizes;
+// direction the light travels
+layout (location = 36) uniform vec3 sunDirection;
+layout (location = 37, binding = 4) uniform sampler2DArrayShadow shadowMap;
+
+const vec3 SUN_COLOR = vec3(1.0, 0.95, 0.85);
+const vec3 AMBIENT = vec3(0.2);
+
+// fraction of the sun reaching a point, filtered over 3x3 hardware 2x2 PCF taps
+float cascadeShadow(vec3 position, vec3 normal, float viewDepth) {
+    uint cascade = 0u;
+    while(cascade < SHADOW_CASCADES && viewDepth > cascadeSplits[cascade])
+        cascade++;
+    if(cascade == SHADOW_CASCADES)
+        return 1.0;
+    // moving the lookup out along the normal by a texel or two keeps lit surfaces from shadowing themselves
+    position += normal * (cascadeTexelSizes[cascade] * 1.5);
+    vec3 coord = (cascadeViewProjection[cascade] * vec4(position, 1.0)).xyz * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int y = -1; y <= 1; y++)
+        for(int x = -1; x <= 1; x++)
+            lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z));
+    return lit / 9.0;
+}
+
+vec3 sunLighting(vec3 position, vec3 normal, float viewDepth) {
+    float lambert = max(dot(normal, -sunDirection), 0.0);
+    float shadow = lambert > 0.0 ? cascadeShadow(position, normal, viewDepth) : 0.0;
+    return AMBIENT + SUN_COLOR * (lambert * shadow);
+}
@@ -1,11 +1,11 @@
-#version 330 core
-out vec4 FragColor;
+#version 460 core
+layout (location = 0) out vec4 FragColor;
 
-in vec3 TexCoords;
+layout (location = 0) in vec3 TexCoords;
 
-uniform samplerCube skybox;
+layout (location = 60, binding = 0) uniform samplerCube skybox;
 
 void main()
-{    
+{
     FragColor = texture(skybox, TexCoords);
 }
@@ -1,14 +1,16 @@
-#version 330 core
+#version 460 core
+// Unit cube around the camera. Only the view's rotation is applied, and z is replaced by w so the sky lands
+// on the far plane: drawn last with GL_LEQUAL it only shades pixels no geometry covered.
 layout (location = 0) in vec3 aPos;
-layout (std140) uniform Matrices {
-    mat4 projection;
-    mat4 view;
-};
-out vec3 TexCoords;
+
+layout (location = 0) uniform mat4 projection;
+layout (location = 1) uniform mat4 view;
+
+layout (location = 0) out vec3 TexCoords;
 
 void main()
 {
     TexCoords = aPos;
     vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
-}  
\ No newline at end of file
+}
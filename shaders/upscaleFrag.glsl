@@ -0,0 +1,42 @@
+#version 460 core
+// Catmull-Rom upscale of the dynamic-resolution target. The 4x4 kernel is folded into 9 bilinear taps
+// by merging the two middle weights of each axis into one fetch between their texels.
+layout (location = 0) out vec4 FragColor;
+
+layout (location = 0) in vec2 TexCoords;
+
+layout (location = 0, binding = 0) uniform sampler2D source;
+// size in texels of the rendered region, which starts at the texture's origin
+layout (location = 1) uniform vec2 sourceSize;
+
+void main() {
+    vec2 textureScale = 1.0 / vec2(textureSize(source, 0));
+    vec2 samplePos = TexCoords * sourceSize;
+    vec2 center = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - center;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    // clamped to the rendered region so the kernel never reads the stale texels past its edge
+    vec2 lo = vec2(0.5), hi = sourceSize - 0.5;
+    vec2 p0 = clamp(center - 1.0, lo, hi) * textureScale;
+    vec2 p12 = clamp(center + w2 / w12, lo, hi) * textureScale;
+    vec2 p3 = clamp(center + 2.0, lo, hi) * textureScale;
+
+    vec4 color = vec4(0.0);
+    color += texture(source, vec2(p0.x, p0.y)) * w0.x * w0.y;
+    color += texture(source, vec2(p12.x, p0.y)) * w12.x * w0.y;
+    color += texture(source, vec2(p3.x, p0.y)) * w3.x * w0.y;
+    color += texture(source, vec2(p0.x, p12.y)) * w0.x * w12.y;
+    color += texture(source, vec2(p12.x, p12.y)) * w12.x * w12.y;
+    color += texture(source, vec2(p3.x, p12.y)) * w3.x * w12.y;
+    color += texture(source, vec2(p0.x, p3.y)) * w0.x * w3.y;
+    color += texture(source, vec2(p12.x, p3.y)) * w12.x * w3.y;
+    color += texture(source, vec2(p3.x, p3.y)) * w3.x * w3.y;
+    // the negative lobes overshoot at hard edges
+    FragColor = max(color, vec4(0.0));
+}
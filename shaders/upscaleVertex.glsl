@@ -0,0 +1,9 @@
+#version 460 core
+// One triangle covering the viewport, generated from gl_VertexID so no vertex buffer is bound
+layout (location = 0) out vec2 TexCoords;
+
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
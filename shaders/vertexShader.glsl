@@ -1,14 +1,33 @@
 #version 460 core
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+#include "instance.glsl"
 
-out vec2 TexCoords;
+layout (location = 0) uniform mat4 projection;
+layout (location = 1) uniform mat4 view;
+
+layout (location = 0) out vec2 TexCoords;
+#if defined(CLUSTERED_LIGHTING) || defined(CASCADED_SHADOWS)
+layout (location = 1) out vec3 WorldPos;
+layout (location = 2) out vec3 WorldNormal;
+layout (location = 3) out float ViewDepth;
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    mat4 world = instanceTransform();
+    vec4 worldPos = world * vec4(aPos, 1.0);
+    vec4 viewPos = view * worldPos;
+    gl_Position = projection * viewPos;
     TexCoords = aTexCoords;
+#if defined(CLUSTERED_LIGHTING) || defined(CASCADED_SHADOWS)
+    WorldPos = worldPos.xyz;
+    // every transform here scales uniformly, so the upper 3x3 keeps normals perpendicular
+    WorldNormal = mat3(world) * aNormal;
+    ViewDepth = -viewPos.z;
+#endif
 }
@@ -0,0 +1,132 @@
+#include "benchmark.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+bool parseUnsigned(const char *text, unsigned long long &value) {
+    char *end;
+    value = std::strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+// non-empty comma separated list of counts above zero
+bool parseCounts(const char *text, std::vector<unsigned int> &counts) {
+    counts.clear();
+    std::stringstream list(text);
+    std::string item;
+    unsigned long long number = 0;
+    while(std::getline(list, item, ',')) {
+        if(!parseUnsigned(item.c_str(), number) || number == 0)
+            return false;
+        counts.push_back(static_cast<unsigned int>(number));
+    }
+    return !counts.empty();
+}
+
+bool parseFloat(const char *text, float &value) {
+    char *end;
+    value = std::strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+void printUsage(const char *program) {
+    std::cerr << "usage: " << program << " [--bench [--frames N] [--warmup N] [--seed N] [--counts N,N,...] [--out file.json]] [--camera-path file] [--target-ms N] [--lights N] [--light-counts N,N,...]" << std::endl;
+}
+
+void writeStats(std::ostream &out, const char *name, const std::vector<double> &values) {
+    out << "      \"" << name << "\": {\"p50\": " << Percentile(values, 50.0) << ", \"p95\": " << Percentile(values, 95.0)
+        << ", \"p99\": " << Percentile(values, 99.0) << ", \"max\": " << Percentile(values, 100.0) << "}";
+}
+
+}
+
+bool ParseBenchOptions(int argc, char **argv, BenchOptions &options) {
+    for(int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        unsigned long long number = 0;
+        if(std::strcmp(arg, "--bench") == 0) {
+            options.enabled = true;
+        } else if(std::strcmp(arg, "--frames") == 0 && value && parseUnsigned(value, number) && number > 0) {
+            options.frames = static_cast<unsigned int>(number);
+            i++;
+        } else if(std::strcmp(arg, "--warmup") == 0 && value && parseUnsigned(value, number)) {
+            options.warmup = static_cast<unsigned int>(number);
+            i++;
+        } else if(std::strcmp(arg, "--seed") == 0 && value && parseUnsigned(value, number)) {
+            options.seed = static_cast<uint32_t>(number);
+            i++;
+        } else if(std::strcmp(arg, "--out") == 0 && value) {
+            options.output = value;
+            i++;
+        } else if(std::strcmp(arg, "--target-ms") == 0 && value && parseFloat(value, options.targetMs) && options.targetMs > 0.0f) {
+            i++;
+        } else if(std::strcmp(arg, "--lights") == 0 && value && parseUnsigned(value, number)) {
+            options.lights = static_cast<unsigned int>(number);
+            i++;
+        } else if(std::strcmp(arg, "--camera-path") == 0 && value) {
+            options.cameraPath = value;
+            i++;
+        } else if(std::strcmp(arg, "--counts") == 0 && value && parseCounts(value, options.counts)) {
+            i++;
+        } else if(std::strcmp(arg, "--light-counts") == 0 && value && parseCounts(value, options.lightCounts)) {
+            i++;
+        } else {
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+double Percentile(std::vector<double> values, double p) {
+    if(values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    auto rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+}
+
+glm::mat4 BenchCameraView(float t) {
+    float angle = t * 2.0f * glm::pi<float>();
+    float radius = 80.0f - 30.0f * std::sin(angle * 2.0f);
+    glm::vec3 position(std::cos(angle) * radius, 12.0f * std::cos(angle * 3.0f), std::sin(angle) * radius);
+    return glm::lookAt(position, glm::vec3(0.0f, -3.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+bool WriteBenchReport(const BenchOptions &options, const std::vector<BenchResult> &results, const std::string &renderer) {
+    std::ostringstream out;
+    out << "{\n  \"renderer\": \"" << renderer << "\",\n  \"seed\": " << options.seed << ",\n  \"frames\": " << options.frames
+        << ",\n  \"runs\": [\n";
+    for(auto i = 0U; i < results.size(); i++) {
+        auto &result = results[i];
+        out << "    {\n      \"asteroids\": " << result.asteroids << ",\n      \"lights\": " << result.lights
+            << ",\n      \"overflow_clusters\": " << result.overflowClusters << ",\n";
+        writeStats(out, "cpu_ms", result.cpuMs);
+        out << ",\n";
+        writeStats(out, "gpu_ms", result.gpuMs);
+        out << ",\n      \"draw_calls\": " << result.drawCalls << ",\n      \"triangles\": " << result.triangles
+            << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+
+    if(options.output.empty()) {
+        std::cout << out.str();
+        return true;
+    }
+    std::ofstream file(options.output, std::ios::trunc);
+    file << out.str();
+    if(!file) {
+        std::cerr << "failed to write benchmark report: " << options.output << std::endl;
+        return false;
+    }
+    return true;
+}
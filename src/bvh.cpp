@@ -0,0 +1,359 @@
+#include "bvh.h"
+#include "jobsystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+// a radix pass spends about a nanosecond per item, so this keeps a slice at tens of microseconds, well
+// above the cost of waking a worker; smaller builds use fewer slices rather than shorter ones
+const size_t MIN_ITEMS_PER_THREAD = 16384;
+// traversal stack kept on the machine stack; deeper trees (up to the 64 levels of the keys) use the heap
+const uint32_t STACK_SIZE = 64;
+
+enum Overlap { OUTSIDE, PARTIAL, INSIDE };
+
+unsigned int threadCount(unsigned int threads, size_t count) {
+    if(threads == 0)
+        threads = JobSystem::Instance().ThreadCount();
+    return static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threads, count / MIN_ITEMS_PER_THREAD)));
+}
+
+// spreads the low 10 bits of v to every third bit
+uint32_t expandBits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+uint32_t mortonCode(const glm::vec3 &unit) {
+    auto quantize = [](float v) { return static_cast<uint32_t>(std::min(std::max(v * 1024.0f, 0.0f), 1023.0f)); };
+    return expandBits(quantize(unit.x)) << 2 | expandBits(quantize(unit.y)) << 1 | expandBits(quantize(unit.z));
+}
+
+// stable LSD radix sort of (code, id) pairs, 8 bits per pass; each thread histograms and scatters its own slice
+void radixSort(std::vector<uint32_t> &codes, std::vector<uint32_t> &ids, unsigned int threads) {
+    JobSystem &jobs = JobSystem::Instance();
+    size_t count = codes.size();
+    std::vector<uint32_t> codesOut(count), idsOut(count);
+    std::vector<size_t> offsets(threads * 256);
+    for(int shift = 0; shift < 32; shift += 8) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        jobs.ParallelSlices(threads, count, [&](size_t begin, size_t end, unsigned int t) {
+            for(auto i = begin; i < end; i++)
+                offsets[t * 256 + ((codes[i] >> shift) & 0xFF)]++;
+        });
+        size_t running = 0;
+        for(auto digit = 0U; digit < 256; digit++) {
+            for(auto t = 0U; t < threads; t++) {
+                size_t n = offsets[t * 256 + digit];
+                offsets[t * 256 + digit] = running;
+                running += n;
+            }
+        }
+        jobs.ParallelSlices(threads, count, [&](size_t begin, size_t end, unsigned int t) {
+            for(auto i = begin; i < end; i++) {
+                size_t position = offsets[t * 256 + ((codes[i] >> shift) & 0xFF)]++;
+                codesOut[position] = codes[i];
+                idsOut[position] = ids[i];
+            }
+        });
+        codes.swap(codesOut);
+        ids.swap(idsOut);
+    }
+}
+
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4 &m) {
+    // Gribb & Hartmann: planes are sums and differences of the matrix rows
+    auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2);
+    frustum.planes[5] = row(3) - row(2);
+    for(auto &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::Intersects(const glm::vec4 &sphere) const {
+    for(auto &plane : planes)
+        if(glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w)
+            return false;
+    return true;
+}
+
+void BVH::Build(const glm::vec4 *spheres, uint32_t instanceCount, unsigned int threads) {
+    JobSystem &jobs = JobSystem::Instance();
+    count = instanceCount;
+    nodes.clear();
+    parents.clear();
+    depth = 0;
+    if(count == 0)
+        return;
+    threads = threadCount(threads, count);
+
+    // Morton codes are taken relative to the bounds of the sphere centers
+    std::vector<glm::vec3> sliceMin(threads, glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> sliceMax(threads, glm::vec3(-std::numeric_limits<float>::max()));
+    jobs.ParallelSlices(threads, count, [&](size_t begin, size_t end, unsigned int t) {
+        for(auto i = begin; i < end; i++) {
+            sliceMin[t] = glm::min(sliceMin[t], glm::vec3(spheres[i]));
+            sliceMax[t] = glm::max(sliceMax[t], glm::vec3(spheres[i]));
+        }
+    });
+    glm::vec3 low = sliceMin[0], high = sliceMax[0];
+    for(auto t = 1U; t < threads; t++) {
+        low = glm::min(low, sliceMin[t]);
+        high = glm::max(high, sliceMax[t]);
+    }
+    glm::vec3 scale = 1.0f / glm::max(high - low, glm::vec3(1e-6f));
+
+    std::vector<uint32_t> codes(count);
+    order.resize(count);
+    jobs.ParallelSlices(threads, count, [&](size_t begin, size_t end, unsigned int) {
+        for(auto i = begin; i < end; i++) {
+            codes[i] = mortonCode((glm::vec3(spheres[i]) - low) * scale);
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+    radixSort(codes, order, threads);
+
+    sorted.resize(count);
+    slotOf.resize(count);
+    jobs.ParallelSlices(threads, count, [&](size_t begin, size_t end, unsigned int) {
+        for(auto i = begin; i < end; i++) {
+            sorted[i] = spheres[order[i]];
+            slotOf[order[i]] = static_cast<uint32_t>(i);
+        }
+    });
+
+    uint32_t leaves = (count + LEAF_SIZE - 1) / LEAF_SIZE;
+    leafStart = leaves - 1;
+    nodes.resize(2 * leaves - 1);
+    parents.assign(nodes.size(), NONE);
+    for(auto leaf = 0U; leaf < leaves; leaf++) {
+        nodes[leafStart + leaf].left = leaf * LEAF_SIZE;
+        nodes[leafStart + leaf].right = std::min(count, (leaf + 1) * LEAF_SIZE) - leaf * LEAF_SIZE;
+    }
+
+    // a leaf's key is the code of its first instance, made unique by appending the leaf index
+    std::vector<uint64_t> keys(leaves);
+    jobs.ParallelSlices(threads, leaves, [&](size_t begin, size_t end, unsigned int) {
+        for(auto leaf = begin; leaf < end; leaf++)
+            keys[leaf] = uint64_t(codes[leaf * LEAF_SIZE]) << 32 | uint64_t(leaf);
+    });
+    auto delta = [&](int64_t i, int64_t j) {
+        if(j < 0 || j >= int64_t(leaves))
+            return -1;
+        return __builtin_clzll(keys[i] ^ keys[j]);
+    };
+    jobs.ParallelSlices(threads, leafStart, [&](size_t begin, size_t end, unsigned int) {
+        for(auto node = int64_t(begin); node < int64_t(end); node++) {
+            // direction of the range this node covers, then its far end by exponential and binary search
+            int direction = delta(node, node + 1) - delta(node, node - 1) >= 0 ? 1 : -1;
+            int minPrefix = delta(node, node - direction);
+            int64_t maxLength = 2;
+            while(delta(node, node + maxLength * direction) > minPrefix)
+                maxLength *= 2;
+            int64_t length = 0;
+            for(auto step = maxLength / 2; step >= 1; step /= 2)
+                if(delta(node, node + (length + step) * direction) > minPrefix)
+                    length += step;
+            int64_t other = node + length * direction;
+
+            // split where the common prefix of the range ends
+            int nodePrefix = delta(node, other);
+            int64_t split = 0;
+            for(int64_t divisor = 2, step = length; step > 1; divisor *= 2) {
+                step = (length + divisor - 1) / divisor;
+                if(delta(node, node + (split + step) * direction) > nodePrefix)
+                    split += step;
+            }
+            int64_t gamma = node + split * direction + std::min(direction, 0);
+
+            uint32_t left = std::min(node, other) == gamma ? leafStart + uint32_t(gamma) : uint32_t(gamma);
+            uint32_t right = std::max(node, other) == gamma + 1 ? leafStart + uint32_t(gamma + 1) : uint32_t(gamma + 1);
+            nodes[node].left = left;
+            nodes[node].right = right;
+            parents[left] = uint32_t(node);
+            parents[right] = uint32_t(node);
+        }
+    });
+
+    // a depth-first traversal holds at most one sibling per level plus the two children of the deepest node
+    std::vector<uint32_t> sliceDepth(threads, 0);
+    jobs.ParallelSlices(threads, leaves, [&](size_t begin, size_t end, unsigned int t) {
+        for(auto leaf = begin; leaf < end; leaf++) {
+            uint32_t levels = 0;
+            for(uint32_t node = parents[leafStart + leaf]; node != NONE; node = parents[node])
+                levels++;
+            sliceDepth[t] = std::max(sliceDepth[t], levels);
+        }
+    });
+    depth = *std::max_element(sliceDepth.begin(), sliceDepth.end());
+
+    Refit(sorted.data(), threads);
+}
+
+void BVH::fitLeaf(uint32_t node) {
+    Node &leaf = nodes[node];
+    leaf.min = glm::vec3(std::numeric_limits<float>::max());
+    leaf.max = glm::vec3(-std::numeric_limits<float>::max());
+    for(auto slot = leaf.left; slot < leaf.left + leaf.right; slot++) {
+        glm::vec3 center(sorted[slot]);
+        leaf.min = glm::min(leaf.min, center - sorted[slot].w);
+        leaf.max = glm::max(leaf.max, center + sorted[slot].w);
+    }
+}
+
+void BVH::fitInternal(uint32_t node) {
+    Node &parent = nodes[node];
+    parent.min = glm::min(nodes[parent.left].min, nodes[parent.right].min);
+    parent.max = glm::max(nodes[parent.left].max, nodes[parent.right].max);
+}
+
+void BVH::Refit(const glm::vec4 *spheres, unsigned int threads) {
+    JobSystem &jobs = JobSystem::Instance();
+    if(count == 0)
+        return;
+    threads = threadCount(threads, count);
+    uint32_t leaves = static_cast<uint32_t>(nodes.size()) - leafStart;
+
+    // the second child to arrive at a node fits it and carries on upwards, the first one stops there
+    std::vector<std::atomic<uint32_t>> arrivals(leafStart);
+    jobs.ParallelSlices(threads, leaves, [&](size_t begin, size_t end, unsigned int) {
+        for(auto leaf = begin; leaf < end; leaf++) {
+            uint32_t node = leafStart + uint32_t(leaf);
+            if(spheres != sorted.data())
+                for(auto slot = nodes[node].left; slot < nodes[node].left + nodes[node].right; slot++)
+                    sorted[slot] = spheres[order[slot]];
+            fitLeaf(node);
+            for(node = parents[node]; node != NONE; node = parents[node]) {
+                if(arrivals[node].fetch_add(1, std::memory_order_acq_rel) == 0)
+                    break;
+                fitInternal(node);
+            }
+        }
+    });
+}
+
+void BVH::Refit(const glm::vec4 *spheres, const std::vector<uint32_t> &moved) {
+    if(count == 0)
+        return;
+    for(auto instance : moved) {
+        uint32_t slot = slotOf[instance];
+        sorted[slot] = spheres[instance];
+        uint32_t node = leafStart + slot / LEAF_SIZE;
+        fitLeaf(node);
+        for(node = parents[node]; node != NONE; node = parents[node]) {
+            glm::vec3 oldMin = nodes[node].min, oldMax = nodes[node].max;
+            fitInternal(node);
+            if(nodes[node].min == oldMin && nodes[node].max == oldMax)
+                break;
+        }
+    }
+}
+
+template<typename NodeTest, typename InstanceVisit>
+void BVH::traverse(NodeTest &&test, InstanceVisit &&visit) const {
+    if(count == 0)
+        return;
+    // the top bit of a stack entry marks a subtree already known to be entirely inside
+    const uint32_t INSIDE_BIT = 0x80000000u;
+    uint32_t local[STACK_SIZE];
+    std::vector<uint32_t> heap;
+    uint32_t *stack = local;
+    if(depth + 2 > STACK_SIZE) {
+        heap.resize(depth + 2);
+        stack = heap.data();
+    }
+    int top = 0;
+    stack[top++] = 0;
+    while(top > 0) {
+        uint32_t entry = stack[--top];
+        uint32_t node = entry & ~INSIDE_BIT;
+        bool inside = entry & INSIDE_BIT;
+        if(!inside) {
+            Overlap overlap = test(nodes[node]);
+            if(overlap == OUTSIDE)
+                continue;
+            inside = overlap == INSIDE;
+        }
+        if(isLeaf(node)) {
+            for(auto slot = nodes[node].left; slot < nodes[node].left + nodes[node].right; slot++)
+                visit(slot, inside);
+            continue;
+        }
+        uint32_t flag = inside ? INSIDE_BIT : 0;
+        stack[top++] = nodes[node].right | flag;
+        stack[top++] = nodes[node].left | flag;
+    }
+}
+
+void BVH::QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const {
+    traverse([&](const Node &node) {
+        Overlap overlap = INSIDE;
+        for(auto &plane : frustum.planes) {
+            glm::vec3 normal(plane);
+            // the box corners furthest along and against the plane normal
+            glm::vec3 positive(normal.x > 0.0f ? node.max.x : node.min.x, normal.y > 0.0f ? node.max.y : node.min.y, normal.z > 0.0f ? node.max.z : node.min.z);
+            glm::vec3 negative(normal.x > 0.0f ? node.min.x : node.max.x, normal.y > 0.0f ? node.min.y : node.max.y, normal.z > 0.0f ? node.min.z : node.max.z);
+            if(glm::dot(normal, positive) + plane.w < 0.0f)
+                return OUTSIDE;
+            if(glm::dot(normal, negative) + plane.w < 0.0f)
+                overlap = PARTIAL;
+        }
+        return overlap;
+    }, [&](uint32_t slot, bool inside) {
+        if(inside || frustum.Intersects(sorted[slot]))
+            out.push_back(order[slot]);
+    });
+}
+
+void BVH::QuerySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const {
+    traverse([&](const Node &node) {
+        glm::vec3 closest = glm::clamp(center, node.min, node.max);
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= radius * radius ? PARTIAL : OUTSIDE;
+    }, [&](uint32_t slot, bool) {
+        glm::vec3 offset = glm::vec3(sorted[slot]) - center;
+        float reach = radius + sorted[slot].w;
+        if(glm::dot(offset, offset) <= reach * reach)
+            out.push_back(order[slot]);
+    });
+}
+
+void BVH::QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<RayHit> &out) const {
+    glm::vec3 inverse = 1.0f / direction;
+    traverse([&](const Node &node) {
+        // slab test; IEEE infinities take care of axis-parallel rays
+        glm::vec3 t0 = (node.min - origin) * inverse;
+        glm::vec3 t1 = (node.max - origin) * inverse;
+        glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+        return enter <= exit ? PARTIAL : OUTSIDE;
+    }, [&](uint32_t slot, bool) {
+        glm::vec3 toCenter = glm::vec3(sorted[slot]) - origin;
+        float along = glm::dot(toCenter, direction);
+        float squaredRadius = sorted[slot].w * sorted[slot].w;
+        float squaredDistance = glm::dot(toCenter, toCenter) - along * along;
+        if(squaredDistance > squaredRadius)
+            return;
+        float half = std::sqrt(squaredRadius - squaredDistance);
+        if(along + half < 0.0f || along - half > maxDistance)
+            return;
+        out.push_back(RayHit{order[slot], std::max(along - half, 0.0f)});
+    });
+}
@@ -0,0 +1,113 @@
+#include "camerapath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char PATH_MAGIC[4] = {'C', 'P', 'T', 'H'};
+const uint32_t PATH_VERSION = 1;
+const size_t KEY_FLOATS = 7;
+
+}
+
+CameraKey CaptureCameraKey(float time, const Camera &camera) {
+    return CameraKey{time, camera.Position, camera.Yaw, camera.Pitch, camera.Zoom};
+}
+
+CameraKey InterpolateCameraKeys(const CameraKey &a, const CameraKey &b, float t) {
+    // yaw is kept in [0, 360) by Camera, so take the short way across the wrap
+    float yawDelta = std::fmod(b.yaw - a.yaw + 540.0f, 360.0f) - 180.0f;
+    return CameraKey{a.time + (b.time - a.time) * t, glm::mix(a.position, b.position, t), a.yaw + yawDelta * t,
+                     a.pitch + (b.pitch - a.pitch) * t, a.zoom + (b.zoom - a.zoom) * t};
+}
+
+void CameraPath::Record(float time, const Camera &camera) {
+    if(!keys.empty() && time < keys.back().time)
+        time = keys.back().time;
+    keys.push_back(CaptureCameraKey(time, camera));
+}
+
+bool CameraPath::Save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    uint32_t count = static_cast<uint32_t>(keys.size());
+    file.write(PATH_MAGIC, sizeof(PATH_MAGIC));
+    file.write(reinterpret_cast<const char *>(&PATH_VERSION), sizeof(PATH_VERSION));
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    for(auto &key : keys) {
+        float values[KEY_FLOATS] = {key.time, key.position.x, key.position.y, key.position.z, key.yaw, key.pitch, key.zoom};
+        file.write(reinterpret_cast<const char *>(values), sizeof(values));
+    }
+    if(!file) {
+        std::cerr << "failed to write camera path: " << path << std::endl;
+        return false;
+    }
+    std::cout << "saved camera path: " << path << " (" << keys.size() << " keys, " << Duration() << " s)" << std::endl;
+    return true;
+}
+
+bool CameraPath::Load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if(!file || std::memcmp(magic, PATH_MAGIC, sizeof(magic)) != 0 || version != PATH_VERSION) {
+        std::cerr << "not a camera path file: " << path << std::endl;
+        return false;
+    }
+
+    // the count comes from disk, so it must match what the file holds before anything is allocated for it
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(path, error);
+    uint64_t header = sizeof(magic) + sizeof(version) + sizeof(count);
+    if(error || fileSize - header != uint64_t(count) * KEY_FLOATS * sizeof(float)) {
+        std::cerr << "truncated camera path: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<CameraKey> loaded(count);
+    for(auto &key : loaded) {
+        float values[KEY_FLOATS];
+        file.read(reinterpret_cast<char *>(values), sizeof(values));
+        key = CameraKey{values[0], glm::vec3(values[1], values[2], values[3]), values[4], values[5], values[6]};
+    }
+    if(!file) {
+        std::cerr << "truncated camera path: " << path << std::endl;
+        return false;
+    }
+    keys = std::move(loaded);
+    std::cout << "loaded camera path: " << path << " (" << keys.size() << " keys, " << Duration() << " s)" << std::endl;
+    return true;
+}
+
+void CameraPath::Apply(float time, Camera &camera, bool loop) const {
+    if(keys.empty())
+        return;
+    float duration = Duration();
+    if(loop && duration > 0.0f)
+        time = std::fmod(std::max(time, 0.0f), duration);
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), time, [](float t, const CameraKey &key){ return t < key.time; });
+    if(next == keys.begin()) {
+        camera.SetState(next->position, next->yaw, next->pitch, next->zoom);
+        return;
+    }
+    if(next == keys.end()) {
+        auto &last = keys.back();
+        camera.SetState(last.position, last.yaw, last.pitch, last.zoom);
+        return;
+    }
+
+    auto &a = *(next - 1);
+    auto &b = *next;
+    float span = b.time - a.time;
+    float t = span > 0.0f ? (time - a.time) / span : 1.0f;
+    CameraKey key = InterpolateCameraKeys(a, b, t);
+    camera.SetState(key.position, key.yaw, key.pitch, key.zoom);
+}
@@ -0,0 +1,105 @@
+#include "clusteredlighting.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace clusters = shader_reflection::clusters;
+namespace culling = shader_reflection::lightCulling;
+namespace forward = shader_reflection::fragmentShader;
+
+ClusteredLighting::ClusteredLighting(float nearDepth, float farDepth) : nearDepth(nearDepth), farDepth(farDepth) {
+}
+
+void ClusteredLighting::create() {
+    glGenBuffers(1, &lightBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_LIGHTS * sizeof(PointLight), nullptr, GL_DYNAMIC_DRAW);
+    // zeroed so a frame drawn before the first culling pass sees empty clusters
+    std::vector<uint32_t> zeros(CLUSTERS, 0);
+    glGenBuffers(1, &countBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTERS * sizeof(uint32_t), zeros.data(), GL_DYNAMIC_COPY);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTERS * MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &overflowBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &readbackBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, FRAMES_IN_FLIGHT * 2 * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void ClusteredLighting::resolve(unsigned int slot) {
+    if(!fences[slot])
+        return;
+    GLenum status = glClientWaitSync(fences[slot], 0, 0);
+    if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+    uint32_t overflow[2];
+    glBindBuffer(GL_COPY_READ_BUFFER, readbackBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, slot * sizeof(overflow), sizeof(overflow), overflow);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    overflowClusters = overflow[0];
+    droppedLights = overflow[1];
+}
+
+void ClusteredLighting::SetLights(const std::vector<PointLight> &lights) {
+    if(!lightBuffer)
+        create();
+    lightCount = static_cast<unsigned int>(std::min<size_t>(lights.size(), MAX_LIGHTS));
+    if(lightCount == 0)
+        return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightCount * sizeof(PointLight), lights.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ClusteredLighting::Cull(Shader &cullingShader, const glm::mat4 &projection, const glm::mat4 &view) {
+    if(!lightBuffer)
+        create();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusters::block::PointLightsBinding, lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusters::block::ClusterLightCountsBinding, countBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusters::block::ClusterLightIndicesBinding, indexBuffer);
+
+    // until the compute program has linked the lists stay as they were
+    if(!cullingShader.Poll())
+        return;
+    unsigned int slot = frame % FRAMES_IN_FLIGHT;
+    resolve(slot);
+    // a slot still in flight is skipped rather than overwritten, so a slow GPU only delays the counters
+    bool readBack = !fences[slot];
+    const uint32_t zeros[2] = {0, 0};
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, culling::block::ClusterOverflowBinding, overflowBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+    cullingShader.Use();
+    cullingShader.SetMat4(culling::uniform::view, view);
+    cullingShader.SetMat4(culling::uniform::inverseProjection, glm::inverse(projection));
+    cullingShader.SetUInt(culling::uniform::lightCount, lightCount);
+    cullingShader.SetUVec3(clusters::uniform::clusterGrid, glm::uvec3(GRID_X, GRID_Y, GRID_Z));
+    cullingShader.SetVec2(clusters::uniform::clusterDepthRange, glm::vec2(nearDepth, farDepth));
+    glDispatchCompute((CLUSTERS + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    // the forward pass reads the lists from its fragment shaders
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    if(readBack) {
+        glBindBuffer(GL_COPY_READ_BUFFER, overflowBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot * 2 * sizeof(uint32_t), 2 * sizeof(uint32_t));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    frame++;
+}
+
+void ClusteredLighting::Apply(Shader &forwardShader, int width, int height) const {
+    forwardShader.SetUVec3(clusters::uniform::clusterGrid, glm::uvec3(GRID_X, GRID_Y, GRID_Z));
+    forwardShader.SetVec2(clusters::uniform::clusterDepthRange, glm::vec2(nearDepth, farDepth));
+    forwardShader.SetVec2(forward::uniform::clusterTileScale, glm::vec2(float(GRID_X) / std::max(width, 1), float(GRID_Y) / std::max(height, 1)));
+}
@@ -0,0 +1,139 @@
+#include "dynamicresolution.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace upscale = shader_reflection::upscaleFrag;
+
+DynamicResolution::DynamicResolution(ResolutionParams params) : params(params) {
+}
+
+void DynamicResolution::Resize(int width, int height, int samples) {
+    if(width == this->width && height == this->height && samples == this->samples)
+        return;
+    release();
+    this->width = width;
+    this->height = height;
+    this->samples = samples;
+    if(width <= 0 || height <= 0)
+        return;
+
+    if(!emptyVAO) {
+        glGenVertexArrays(1, &emptyVAO);
+        glGenQueries(FRAMES_IN_FLIGHT, queries);
+    }
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glGenFramebuffers(1, &sceneFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "dynamic resolution scene framebuffer is incomplete" << std::endl;
+
+    glGenTextures(1, &resolveTexture);
+    glBindTexture(GL_TEXTURE_2D, resolveTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1, &resolveFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolveTexture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "dynamic resolution resolve framebuffer is incomplete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::release() {
+    glDeleteFramebuffers(1, &sceneFramebuffer);
+    glDeleteFramebuffers(1, &resolveFramebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteTextures(1, &resolveTexture);
+    sceneFramebuffer = resolveFramebuffer = colorBuffer = depthBuffer = resolveTexture = 0;
+}
+
+void DynamicResolution::SetEnabled(bool enabled) {
+    this->enabled = enabled;
+    if(!enabled) {
+        scale = area = 1.0f;
+        previousError = 0.0f;
+    }
+}
+
+int DynamicResolution::ScaledWidth() const {
+    return std::max(1, static_cast<int>(width * scale + 0.5f));
+}
+
+int DynamicResolution::ScaledHeight() const {
+    return std::max(1, static_cast<int>(height * scale + 0.5f));
+}
+
+void DynamicResolution::Update() {
+    // the slot Begin() is about to reuse holds the oldest frame; a result that is still not available is dropped
+    unsigned int slot = frame % FRAMES_IN_FLIGHT;
+    if(!queryPending[slot])
+        return;
+    queryPending[slot] = false;
+    GLint available = 0;
+    glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+        return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+    gpuMs = elapsed / 1e6;
+    if(!enabled || params.targetMs <= 0.0f)
+        return;
+
+    float error = (params.targetMs - static_cast<float>(gpuMs)) / params.targetMs;
+    if(std::fabs(error) < params.deadband)
+        error = 0.0f;
+    float minArea = params.minScale * params.minScale, maxArea = params.maxScale * params.maxScale;
+    area += params.proportionalGain * (error - previousError) + params.integralGain * error;
+    area = std::min(std::max(area, minArea), maxArea);
+    previousError = error;
+
+    float target = std::sqrt(area);
+    if(std::fabs(target - scale) >= params.minStep || target == params.minScale || target == params.maxScale)
+        scale = target;
+}
+
+void DynamicResolution::Begin() {
+    glBeginQuery(GL_TIME_ELAPSED, queries[frame % FRAMES_IN_FLIGHT]);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glViewport(0, 0, ScaledWidth(), ScaledHeight());
+}
+
+void DynamicResolution::End(Shader &upscaleShader) {
+    int scaledWidth = ScaledWidth(), scaledHeight = ScaledHeight();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+    glBlitFramebuffer(0, 0, scaledWidth, scaledHeight, 0, 0, scaledWidth, scaledHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+    upscaleShader.Use();
+    upscaleShader.SetVec2(upscale::uniform::sourceSize, glm::vec2(scaledWidth, scaledHeight));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, resolveTexture);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    glEndQuery(GL_TIME_ELAPSED);
+    queryPending[frame % FRAMES_IN_FLIGHT] = true;
+    frame++;
+}
@@ -0,0 +1,158 @@
+#include "fieldgenerator.h"
+#include "jobsystem.h"
+
+#include <algorithm>
+
+namespace {
+
+const unsigned int BATCH = FieldGenerator::BATCH;
+// smallest range ParallelFor splits down to: around a millisecond of Philox and matrix work, so the few
+// microseconds a steal costs stay under a percent, while a million instances still make 30 jobs
+const unsigned int MIN_INSTANCES_PER_JOB = 32768;
+const float TWO_PI = 6.28318530718f;
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"), one lane per instance.
+// Counter is (instance, 0, 0, 0), key is (seed, constant).
+void philox(const uint32_t *instance, uint32_t seed, uint32_t out[4][BATCH]) {
+    uint32_t c0[BATCH], c1[BATCH], c2[BATCH], c3[BATCH];
+    for(auto lane = 0U; lane < BATCH; lane++) {
+        c0[lane] = instance[lane];
+        c1[lane] = 0;
+        c2[lane] = 0;
+        c3[lane] = 0;
+    }
+    uint32_t k0 = seed, k1 = 0x5bd1e995;
+    for(int round = 0; round < 10; round++) {
+        for(auto lane = 0U; lane < BATCH; lane++) {
+            uint64_t p0 = uint64_t(0xD2511F53) * c0[lane];
+            uint64_t p1 = uint64_t(0xCD9E8D57) * c2[lane];
+            uint32_t n0 = uint32_t(p1 >> 32) ^ c1[lane] ^ k0;
+            uint32_t n2 = uint32_t(p0 >> 32) ^ c3[lane] ^ k1;
+            c1[lane] = uint32_t(p1);
+            c3[lane] = uint32_t(p0);
+            c0[lane] = n0;
+            c2[lane] = n2;
+        }
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+    for(auto lane = 0U; lane < BATCH; lane++) {
+        out[0][lane] = c0[lane];
+        out[1][lane] = c1[lane];
+        out[2][lane] = c2[lane];
+        out[3][lane] = c3[lane];
+    }
+}
+
+// [0, 1) from the top 24 bits
+inline float unit(uint32_t bits) {
+    return float(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// [0, 1) from the low 16 bits
+inline float unit16(uint32_t bits) {
+    return float(bits & 0xFFFF) * (1.0f / 65536.0f);
+}
+
+// sin and cos of x >= 0: quadrant reduction plus the Cephes sinf/cosf polynomials on [-pi/4, pi/4],
+// branch-free so the batch loop stays vectorised (std::sin would be a libm call per lane)
+void sincos(const float *x, float *sine, float *cosine) {
+    for(auto lane = 0U; lane < BATCH; lane++) {
+        int quadrant = int(x[lane] * 0.636619772f + 0.5f);
+        float j = float(quadrant);
+        float r = ((x[lane] - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+        float z = r * r;
+        float s = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+        float c = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+        int q = quadrant & 3;
+        float sinValue = (q & 1) ? c : s;
+        float cosValue = (q & 1) ? s : c;
+        sine[lane] = (q & 2) ? -sinValue : sinValue;
+        cosine[lane] = (q == 1 || q == 2) ? -cosValue : cosValue;
+    }
+}
+
+}
+
+FieldGenerator::FieldGenerator(uint32_t seed, FieldParams params) : seed(seed), params(params) {
+}
+
+void FieldGenerator::GenerateRange(glm::mat4 *out, unsigned int first, unsigned int n, unsigned int count, glm::vec4 *bounds) const {
+    glm::vec3 axis = glm::normalize(params.rotationAxis);
+    float ax = axis.x, ay = axis.y, az = axis.z;
+    float step = TWO_PI / float(std::max(count, 1U));
+
+    for(auto base = 0U; base < n; base += BATCH) {
+        uint32_t instance[BATCH];
+        for(auto lane = 0U; lane < BATCH; lane++)
+            instance[lane] = first + base + lane;
+
+        // one Philox block per instance: three 24-bit displacements, then 16 bits each for scale and rotation
+        uint32_t bits[4][BATCH];
+        philox(instance, seed, bits);
+
+        // SoA: one array per quantity
+        float ringAngle[BATCH], rotation[BATCH], ringSin[BATCH], ringCos[BATCH], rotSin[BATCH], rotCos[BATCH];
+        float x[BATCH], y[BATCH], z[BATCH], scale[BATCH];
+        for(auto lane = 0U; lane < BATCH; lane++) {
+            ringAngle[lane] = float(instance[lane]) * step;
+            rotation[lane] = unit16(bits[3][lane]) * TWO_PI;
+        }
+        sincos(ringAngle, ringSin, ringCos);
+        sincos(rotation, rotSin, rotCos);
+        for(auto lane = 0U; lane < BATCH; lane++) {
+            float dx = (unit(bits[0][lane]) * 2.0f - 1.0f) * params.offset;
+            float dy = (unit(bits[1][lane]) * 2.0f - 1.0f) * params.offset;
+            float dz = (unit(bits[2][lane]) * 2.0f - 1.0f) * params.offset;
+            x[lane] = ringSin[lane] * params.radius + dx;
+            y[lane] = dy * params.heightScale;
+            z[lane] = ringCos[lane] * params.radius + dz;
+            scale[lane] = params.minScale + unit16(bits[3][lane] >> 16) * (params.maxScale - params.minScale);
+        }
+
+        // translate * scale * rotate(axis), the same product the glm::translate/scale/rotate chain builds
+        unsigned int lanes = std::min(BATCH, n - base);
+        for(auto lane = 0U; lane < lanes; lane++) {
+            float c = rotCos[lane], s = rotSin[lane], sc = scale[lane];
+            float t = 1.0f - c;
+            float *m = &out[base + lane][0][0];
+            m[0]  = sc * (c + t * ax * ax);
+            m[1]  = sc * (t * ax * ay + s * az);
+            m[2]  = sc * (t * ax * az - s * ay);
+            m[3]  = 0.0f;
+            m[4]  = sc * (t * ay * ax - s * az);
+            m[5]  = sc * (c + t * ay * ay);
+            m[6]  = sc * (t * ay * az + s * ax);
+            m[7]  = 0.0f;
+            m[8]  = sc * (t * az * ax + s * ay);
+            m[9]  = sc * (t * az * ay - s * ax);
+            m[10] = sc * (c + t * az * az);
+            m[11] = 0.0f;
+            m[12] = x[lane];
+            m[13] = y[lane];
+            m[14] = z[lane];
+            m[15] = 1.0f;
+        }
+        if(bounds)
+            for(auto lane = 0U; lane < lanes; lane++)
+                bounds[base + lane] = glm::vec4(x[lane], y[lane], z[lane], scale[lane]);
+    }
+}
+
+void FieldGenerator::Generate(glm::mat4 *out, unsigned int count, unsigned int threads, glm::vec4 *bounds) const {
+    if(threads == 1) {
+        GenerateRange(out, 0, count, count, bounds);
+        return;
+    }
+    // split in whole batches so only the last range has a partial batch; a thread cap becomes the
+    // smallest range that leaves no more than `threads` of them
+    size_t batches = (size_t(count) + BATCH - 1) / BATCH;
+    size_t grain = MIN_INSTANCES_PER_JOB / BATCH;
+    if(threads > 1)
+        grain = std::max(grain, (batches + threads - 1) / threads);
+    JobSystem::Instance().ParallelFor(batches, grain, [&](size_t begin, size_t end) {
+        auto first = static_cast<unsigned int>(begin * BATCH);
+        auto last = static_cast<unsigned int>(std::min<size_t>(count, end * BATCH));
+        GenerateRange(out + first, first, last - first, count, bounds ? bounds + first : nullptr);
+    });
+}
@@ -0,0 +1,73 @@
+#include "framepacer.h"
+
+#include <chrono>
+
+namespace {
+
+// weight of the newest frame in the smoothed latency
+const double SMOOTHING = 0.1;
+const GLuint64 THROTTLE_TIMEOUT_NS = 100000000;
+
+}
+
+void FramePacer::SetLimit(Limit limit, unsigned int maxQueued) {
+    this->limit = limit;
+    this->maxQueued = maxQueued;
+}
+
+void FramePacer::Throttle() {
+    auto start = std::chrono::steady_clock::now();
+    while(!frames.empty() && resolve(false)) {}
+    if(limit == Limit::Fence)
+        while(frames.size() > maxQueued)
+            resolve(true);
+    while(frames.size() > MAX_TRACKED)
+        resolve(true);
+    throttleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FramePacer::LatchInput() {
+    // the GPU clock as of now, comparable with the timestamp queries
+    glGetInteger64v(GL_TIMESTAMP, &latch);
+}
+
+void FramePacer::EndFrame(double scanoutMs) {
+    if(limit == Limit::Finish)
+        glFinish();
+
+    unsigned int query;
+    if(freeQueries.empty()) {
+        glGenQueries(1, &query);
+    } else {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    glQueryCounter(query, GL_TIMESTAMP);
+    frames.push_back(InFlight{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), query, latch, scanoutMs});
+    latch = -1;
+
+    if(limit == Limit::Finish)
+        while(!frames.empty())
+            resolve(true);
+}
+
+bool FramePacer::resolve(bool wait) {
+    InFlight &frame = frames.front();
+    GLenum status = glClientWaitSync(frame.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? THROTTLE_TIMEOUT_NS : 0);
+    bool done = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    if(!done && !wait)
+        return false;
+
+    // a frame that timed out is dropped from the estimate rather than waited on again
+    GLint64 end = 0;
+    if(done)
+        glGetQueryObjecti64v(frame.query, GL_QUERY_RESULT, &end);
+    if(frame.latch >= 0 && end > frame.latch) {
+        double ms = (end - frame.latch) / 1e6 + frame.scanoutMs;
+        latencyMs = latencyMs == 0.0 ? ms : latencyMs + (ms - latencyMs) * SMOOTHING;
+    }
+    glDeleteSync(frame.fence);
+    freeQueries.push_back(frame.query);
+    frames.pop_front();
+    return true;
+}
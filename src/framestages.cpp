@@ -0,0 +1,357 @@
+#include "framestages.h"
+#include "fieldgenerator.h"
+#include "model.h"
+#include "physics.h"
+#include "profiler.h"
+#include "shader.h"
+#include "shader_reflection.h"
+#include "skybox.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace vs = shader_reflection::vertexShader;
+namespace shadowVs = shader_reflection::shadowVertex;
+namespace impostorVs = shader_reflection::impostorVertex;
+namespace instance = shader_reflection::instance;
+
+namespace {
+
+// held keys advance the camera by exactly `step` seconds
+void moveCamera(Camera &camera, const PendingInput &input, float step) {
+    if(!input.flying)
+        return;
+    if(input.forward)
+        camera.ProcessKeyboard(FORWARD, step);
+    if(input.backward)
+        camera.ProcessKeyboard(BACKWARD, step);
+    if(input.left)
+        camera.ProcessKeyboard(LEFT, step);
+    if(input.right)
+        camera.ProcessKeyboard(RIGHT, step);
+    camera.SetSpeed(input.fast ? 10.0f : 5.0f);
+}
+
+// one instance id per instance, on its own binding so the id buffer can be swapped per draw
+void addInstanceIndex(unsigned int VAO) {
+    glBindVertexArray(VAO);
+    glEnableVertexAttribArray(instance::attrib::instanceIndex);
+    glVertexAttribIFormat(instance::attrib::instanceIndex, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(instance::attrib::instanceIndex, instance::attrib::instanceIndex);
+    glVertexBindingDivisor(instance::attrib::instanceIndex, 1);
+}
+
+}
+
+SimulationState::SimulationState(AsteroidField &field, AsteroidPhysics &physics, const MeshRaycaster &raycaster, CameraPath &path,
+                                 std::string pathFile, float aspect)
+    : field(field), physics(physics), raycaster(raycaster), path(path), pathFile(std::move(pathFile)), aspect(aspect) {
+    pathMode = path.Empty() ? PathMode::Live : PathMode::Replaying;
+    previousCamera = CaptureCameraKey(0.0f, camera);
+}
+
+RenderState::RenderState(const SceneShaders &shaders, Model &planet, Model &rock, Skybox &skybox)
+    : shaders(shaders), planet(planet), rock(rock), skybox(skybox) {
+    planetModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -3.0f, 0.0f));
+    planetModel = glm::scale(planetModel, glm::vec3(4.0f, 4.0f, 4.0f));
+
+    glGenBuffers(1, &instanceMatrices);
+    glGenBuffers(1, &allInstances);
+    glGenBuffers(1, &visibleInstances);
+    for(auto &mesh : rock.meshes)
+        for(unsigned int VAO : {mesh.VAO, mesh.positionVAO})
+            addInstanceIndex(VAO);
+
+    glGenVertexArrays(1, &impostorVAO);
+    glGenBuffers(1, &impostorInstances);
+    addInstanceIndex(impostorVAO);
+    glBindVertexBuffer(instance::attrib::instanceIndex, impostorInstances, 0, sizeof(uint32_t));
+    glBindVertexArray(0);
+
+    glGenBuffers(SHADOW_CASCADES, shadowCasters);
+}
+
+glm::vec3 SunDirection(float azimuth, float elevation) {
+    float a = glm::radians(azimuth), e = glm::radians(elevation);
+    return -glm::vec3(std::cos(e) * std::cos(a), std::sin(e), std::cos(e) * std::sin(a));
+}
+
+void CullAsteroids(const AsteroidField &field, const glm::mat4 &projection, const glm::mat4 &view, float impostorDistance,
+                   std::vector<uint32_t> &visible, std::vector<uint32_t> &impostors) {
+    PROFILE_CPU_SCOPE("culling");
+    visible.clear();
+    impostors.clear();
+    field.index.QueryFrustum(Frustum::FromMatrix(projection * view), visible);
+    if(impostorDistance <= 0.0f || !field.impostorsBaked)
+        return;
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    float limit = impostorDistance * impostorDistance;
+    auto far = std::partition(visible.begin(), visible.end(), [&](uint32_t id) {
+        glm::vec3 offset = glm::vec3(field.bounds[id]) - eye;
+        return glm::dot(offset, offset) <= limit;
+    });
+    impostors.assign(far, visible.end());
+    visible.erase(far, visible.end());
+}
+
+// Cascaded sun shadows. Planning and per-cascade caster culling are CPU work done with the frame's camera
+// (on the simulation thread in the viewer); only the cascades the planner marks dirty are rendered.
+void PlanShadows(AsteroidField &field, const glm::mat4 &view, float zoom, float aspect, const glm::vec3 &sun, bool enabled,
+                 ShadowFrame &frame, std::vector<uint32_t> *casters) {
+    PROFILE_CPU_SCOPE("shadow culling");
+    if(!enabled) {
+        field.shadows.Disable(sun, frame);
+        return;
+    }
+    field.shadows.Plan(view, glm::radians(zoom), aspect, 0.1f, sun, frame);
+    for(auto i = 0U; i < SHADOW_CASCADES; i++) {
+        casters[i].clear();
+        if(frame.cascades[i].dirty)
+            field.index.QueryFrustum(Frustum::FromMatrix(frame.cascades[i].viewProjection), casters[i]);
+    }
+}
+
+// The packet's camera blends the last two simulated states by the time left over in the accumulator.
+void SimulateFrame(SimulationState &state, const PendingInput &input, FramePacket &packet) {
+    double start = glfwGetTime();
+    Camera &camera = state.camera;
+    CameraPath &path = state.path;
+    AsteroidField &field = state.field;
+
+    if(input.record) {
+        path.Clear();
+        state.recordStep = 0;
+        state.pathMode = PathMode::Recording;
+    }
+    if(input.replay && !path.Empty() && state.pathMode != PathMode::Recording) {
+        state.replayStep = 0;
+        state.pathMode = PathMode::Replaying;
+    }
+    if((input.stopRecording && state.pathMode == PathMode::Recording) || (input.stopReplay && state.pathMode == PathMode::Replaying))
+        state.pathMode = PathMode::Live;
+    if(input.savePath)
+        path.Save(state.pathFile);
+    if(input.loadPath && state.pathMode != PathMode::Recording)
+        path.Load(state.pathFile);
+
+    if(input.look != glm::vec2(0.0f))
+        camera.ProcessMouseMovement(input.look.x, input.look.y);
+    if(input.scroll != 0.0f)
+        camera.ProcessMouseScroll(input.scroll);
+
+    double time = glfwGetTime();
+    state.accumulator += time - state.lastTime;
+    state.lastTime = time;
+    unsigned int simSteps;
+    for(simSteps = 0; state.accumulator >= SimulationState::STEP && simSteps < SimulationState::MAX_STEPS; simSteps++) {
+        state.accumulator -= SimulationState::STEP;
+        state.previousCamera = CaptureCameraKey(0.0f, camera);
+        moveCamera(camera, input, static_cast<float>(SimulationState::STEP));
+        if(state.pathMode == PathMode::Recording) {
+            path.Record(static_cast<float>(state.recordStep++ * SimulationState::STEP), camera);
+        } else if(state.pathMode == PathMode::Replaying) {
+            auto replayTime = static_cast<float>(state.replayStep++ * SimulationState::STEP);
+            path.Apply(replayTime, camera, input.loopReplay);
+            if(!input.loopReplay && replayTime >= path.Duration())
+                state.pathMode = PathMode::Live;
+        }
+    }
+    if(simSteps == SimulationState::MAX_STEPS)
+        state.accumulator = std::min(state.accumulator, SimulationState::STEP);
+
+    packet.physicsMatrices.clear();
+    if(state.physics.Running()) {
+        PROFILE_CPU_SCOPE("physics sync");
+        glm::vec3 cameraPush;
+        state.physics.SetCamera(camera.Position);
+        if(state.physics.Interpolate(state.physicsMatrices, cameraPush)) {
+            camera.Position += cameraPush;
+            state.previousCamera.position += cameraPush;
+            packet.physicsMatrices = state.physicsMatrices;
+            for(auto i = 0U; i < state.physicsMatrices.size(); i++)
+                field.bounds[i] = glm::vec4(glm::vec3(state.physicsMatrices[i][3]), field.bounds[i].w);
+            field.index.Refit(field.bounds.data(), state.physicsInstances);
+        }
+    }
+
+    // live mouse look is applied as events arrive rather than a step late, so only replays blend the angles
+    CameraKey blended = InterpolateCameraKeys(state.previousCamera, CaptureCameraKey(0.0f, camera),
+                                              static_cast<float>(state.accumulator / SimulationState::STEP));
+    if(state.pathMode != PathMode::Replaying) {
+        blended.yaw = camera.Yaw;
+        blended.pitch = camera.Pitch;
+    }
+    Camera renderCamera = camera;
+    renderCamera.SetState(blended.position, blended.yaw, blended.pitch, blended.zoom);
+    glm::mat4 projection = glm::perspective(glm::radians(renderCamera.Zoom), state.aspect, 0.1f, 10000.0f);
+    glm::mat4 view = renderCamera.GetViewMatrix();
+
+    if(input.pick) {
+        PROFILE_CPU_SCOPE("pick");
+        double pickStart = glfwGetTime();
+        Ray ray = ScreenRay(input.cursor, input.windowSize, projection, view);
+        // matrices live only on the GPU; the generator recomputes any single one on demand
+        FieldGenerator generator(field.seed);
+        state.picked = PickInstance(ray, field.index, state.raycaster, [&](uint32_t id) {
+            if(id < state.physicsMatrices.size())
+                return state.physicsMatrices[id];
+            glm::mat4 matrix;
+            generator.GenerateRange(&matrix, id, 1, field.count);
+            return matrix;
+        }, state.pick);
+        state.pickMs = (glfwGetTime() - pickStart) * 1000.0;
+    }
+
+    packet.culled = input.frustumCulling;
+    if(packet.culled)
+        CullAsteroids(field, projection, view, input.impostors ? input.impostorDistance : 0.0f, packet.visible, packet.impostors);
+    field.shadows.Params().cacheFarCascades = input.cacheShadows;
+    PlanShadows(field, view, renderCamera.Zoom, state.aspect, SunDirection(input.sunAzimuth, input.sunElevation), input.shadows,
+                packet.shadow, packet.shadowCasters);
+
+    packet.index = state.frame++;
+    packet.projection = projection;
+    packet.view = view;
+    packet.cameraPosition = camera.Position;
+    packet.camera = renderCamera;
+    packet.lateLatch = state.pathMode != PathMode::Replaying;
+    packet.simSteps = simSteps;
+    packet.picked = state.picked;
+    packet.pick = state.pick;
+    packet.pickMs = state.pickMs;
+    packet.pathMode = state.pathMode;
+    packet.pathKeys = path.Size();
+    packet.pathDuration = path.Duration();
+    packet.simMs = (glfwGetTime() - start) * 1000.0;
+}
+
+void RenderShadows(RenderState &state, const ShadowFrame &frame, const std::vector<uint32_t> *casters) {
+    PROFILE_SCOPE("shadows");
+    Shader &shadowShader = state.shaders.shadow, &ringShadowShader = state.shaders.ringShadow;
+    for(auto i = 0U; i < SHADOW_CASCADES; i++) {
+        const ShadowCascade &cascade = frame.cascades[i];
+        if(!cascade.dirty)
+            continue;
+        state.shadowMaps.Begin(i);
+        shadowShader.Use();
+        shadowShader.SetMat4(shadowVs::uniform::lightViewProjection, cascade.viewProjection);
+        shadowShader.SetMat4(instance::uniform::model, state.planetModel);
+        for(auto &mesh : state.planet.meshes) {
+            glBindVertexArray(mesh.positionVAO);
+            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
+        }
+
+        // indexed-instance programs have no placeholder: it would read the uint instance index as a matrix
+        if(!casters[i].empty() && ringShadowShader.Poll()) {
+            glBindBuffer(GL_ARRAY_BUFFER, state.shadowCasters[i]);
+            glBufferData(GL_ARRAY_BUFFER, casters[i].size() * sizeof(uint32_t), casters[i].data(), GL_STREAM_DRAW);
+            ringShadowShader.Use();
+            ringShadowShader.SetMat4(shadowVs::uniform::lightViewProjection, cascade.viewProjection);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance::block::InstanceMatricesBinding, state.instanceMatrices);
+            for(auto &mesh : state.rock.meshes) {
+                glBindVertexArray(mesh.positionVAO);
+                glBindVertexBuffer(instance::attrib::instanceIndex, state.shadowCasters[i], 0, sizeof(uint32_t));
+                glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0,
+                                        static_cast<unsigned int>(casters[i].size()));
+            }
+        }
+        glBindVertexArray(0);
+    }
+    state.shadowMaps.End();
+}
+
+SceneStats DrawScene(RenderState &state, const glm::mat4 &projection, const glm::mat4 &view, const std::vector<uint32_t> *visible,
+                     const std::vector<uint32_t> *impostors, const ShadowFrame &shadow, bool sky) {
+    SceneStats stats;
+    SceneShaders &shaders = state.shaders;
+
+    {
+        PROFILE_SCOPE("light culling");
+        state.lighting.Cull(shaders.lightCulling, projection, view);
+    }
+    // clusters tile whatever viewport the scene renders into, which dynamic resolution scales
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    {
+        PROFILE_SCOPE("planet");
+        Shader &shader = shaders.forward;
+        shader.Use();
+        shader.SetMat4(vs::uniform::projection, projection);
+        shader.SetMat4(vs::uniform::view, view);
+        shader.SetMat4(instance::uniform::model, state.planetModel);
+        state.lighting.Apply(shader, viewport[2], viewport[3]);
+        state.shadowMaps.Apply(shader, shadow);
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        state.planet.Draw(shader);
+        for(auto &mesh : state.planet.meshes) {
+            stats.drawCalls++;
+            stats.triangles += mesh.indices.size() / 3;
+        }
+    }
+
+    unsigned int instances = state.asteroids, instanceIds = state.allInstances;
+    if(visible) {
+        // respecifying the store orphans last frame's, so the upload does not wait for its draw
+        glBindBuffer(GL_ARRAY_BUFFER, state.visibleInstances);
+        glBufferData(GL_ARRAY_BUFFER, visible->size() * sizeof(uint32_t), visible->data(), GL_STREAM_DRAW);
+        instances = static_cast<unsigned int>(visible->size());
+        instanceIds = state.visibleInstances;
+    }
+    stats.asteroids = instances;
+
+    // skipped until the program links, like the shadow and impostor passes
+    if(shaders.ring.Poll()) {
+        PROFILE_SCOPE("ring");
+        Shader &ringShader = shaders.ring;
+        ringShader.Use();
+        ringShader.SetMat4(vs::uniform::projection, projection);
+        ringShader.SetMat4(vs::uniform::view, view);
+        state.lighting.Apply(ringShader, viewport[2], viewport[3]);
+        state.shadowMaps.Apply(ringShader, shadow);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance::block::InstanceMatricesBinding, state.instanceMatrices);
+        for(auto &mesh : state.rock.meshes) {
+            glBindVertexArray(mesh.VAO);
+            glBindVertexBuffer(instance::attrib::instanceIndex, instanceIds, 0, sizeof(uint32_t));
+            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0, instances);
+            glBindVertexArray(0);
+            stats.drawCalls++;
+            stats.triangles += mesh.indices.size() / 3 * instances;
+        }
+    }
+
+    if(impostors && !impostors->empty() && shaders.impostor.Poll()) {
+        PROFILE_SCOPE("impostors");
+        Shader &impostorShader = shaders.impostor;
+        glBindBuffer(GL_ARRAY_BUFFER, state.impostorInstances);
+        glBufferData(GL_ARRAY_BUFFER, impostors->size() * sizeof(uint32_t), impostors->data(), GL_STREAM_DRAW);
+        auto count = static_cast<unsigned int>(impostors->size());
+        impostorShader.Use();
+        impostorShader.SetMat4(impostorVs::uniform::projection, projection);
+        impostorShader.SetMat4(impostorVs::uniform::view, view);
+        impostorShader.SetVec3(impostorVs::uniform::cameraPosition, glm::vec3(glm::inverse(view)[3]));
+        state.impostorAtlas.Apply(impostorShader);
+        state.shadowMaps.Apply(impostorShader, shadow);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance::block::InstanceMatricesBinding, state.instanceMatrices);
+        glBindVertexArray(state.impostorVAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glBindVertexArray(0);
+        stats.impostors = count;
+        stats.drawCalls++;
+        stats.triangles += 2ULL * count;
+    }
+
+    // last among the opaque passes, so the depth buffer rejects every covered sky pixel before shading
+    if(sky && state.skybox.Loaded()) {
+        PROFILE_SCOPE("skybox");
+        state.skybox.Draw(shaders.skybox, projection, view);
+        stats.drawCalls++;
+        stats.triangles += 12;
+    }
+    return stats;
+}
@@ -0,0 +1,95 @@
+#include "impostor.h"
+#include "model.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+namespace impostor = shader_reflection::impostor;
+namespace bakeVs = shader_reflection::impostorBakeVertex;
+
+namespace {
+
+// mip levels down to 16x16 cells; smaller ones would bleed between neighbouring views
+const int MIP_LEVELS = 4;
+
+unsigned int atlasTexture() {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, MIP_LEVELS, GL_RGBA8, ImpostorAtlas::SIZE, ImpostorAtlas::SIZE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MIP_LEVELS - 1);
+    return texture;
+}
+
+}
+
+bool ImpostorAtlas::Bake(Model &model, Shader &bake, float radius) {
+    if(!bake.Poll()) {
+        std::cerr << "impostor bake program is not available, asteroids stay meshes at every distance" << std::endl;
+        return false;
+    }
+    this->radius = radius;
+    albedo = atlasTexture();
+    normalDepth = atlasTexture();
+    unsigned int depth, framebuffer;
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SIZE, SIZE);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalDepth, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "impostor bake framebuffer is incomplete" << std::endl;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    // uncovered texels: no albedo coverage and a normal of zero length
+    float clearAlbedo[] = {0.0f, 0.0f, 0.0f, 0.0f}, clearNormal[] = {0.5f, 0.5f, 0.5f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, clearAlbedo);
+    glClearBufferfv(GL_COLOR, 1, clearNormal);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    bake.Use();
+    bake.SetInt(impostor::uniform::impostorGrid, GRID);
+    bake.SetFloat(impostor::uniform::impostorRadius, radius);
+    for(int y = 0; y < GRID; y++) {
+        for(int x = 0; x < GRID; x++) {
+            glViewport(x * CELL_SIZE, y * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+            bake.SetIVec2(bakeVs::uniform::impostorCell, glm::ivec2(x, y));
+            model.Draw(bake);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    for(unsigned int texture : {albedo, normalDepth}) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void ImpostorAtlas::Apply(Shader &impostorShader) const {
+    impostorShader.SetInt(impostor::uniform::impostorGrid, GRID);
+    impostorShader.SetFloat(impostor::uniform::impostorRadius, radius);
+    // units match the bindings of impostorAlbedo and impostorNormalDepth in impostorFrag.glsl
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, albedo);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalDepth);
+    glActiveTexture(GL_TEXTURE0);
+}
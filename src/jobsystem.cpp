@@ -0,0 +1,262 @@
+#include "jobsystem.h"
+
+#include <algorithm>
+
+namespace {
+
+// yields before an idle worker goes to sleep, so a burst of jobs does not pay for a wake-up each
+const int IDLE_SPINS = 64;
+
+// the pool the current thread works for, if any, and its deque
+thread_local const JobSystem *currentSystem = nullptr;
+thread_local int currentWorker = -1;
+
+// xorshift32 for picking steal victims
+uint32_t nextVictim() {
+    thread_local uint32_t state = 0x9E3779B9u ^ static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+}
+
+bool JobSystem::WorkDeque::Push(Job *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if(b - t >= CAPACITY)
+        return false;
+    slots[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+JobSystem::Job *JobSystem::WorkDeque::Pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if(t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job *job = slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if(t == b) {
+        // last job: race the thieves for it
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job *JobSystem::WorkDeque::Steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if(t >= b)
+        return nullptr;
+    Job *job = slots[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+JobSystem::JobSystem(unsigned int threads) {
+    if(threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    unsigned int workerCount = threads - 1;
+    for(auto i = 0U; i < workerCount; i++)
+        deques.emplace_back(new WorkDeque());
+    for(auto i = 0U; i < workerCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_all();
+    }
+    for(auto &worker : workers)
+        worker.join();
+    // whatever is still queued was never waited for
+    for(auto &deque : deques)
+        while(Job *job = deque->Pop())
+            delete job;
+    for(auto job : shared)
+        delete job;
+}
+
+JobSystem &JobSystem::Instance() {
+    static JobSystem instance;
+    return instance;
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter *counter) {
+    if(counter)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    enqueue(new Job{std::move(job), counter});
+}
+
+void JobSystem::enqueue(Job *job) {
+    // counted before it becomes visible, so a thief can never take it before the count covers it
+    queued.fetch_add(1);
+    if(currentSystem != this || currentWorker < 0 || !deques[currentWorker]->Push(job)) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        shared.push_back(job);
+    }
+    // pairs with the sleepers increment in workerLoop: either this sees the sleeper or it sees the job
+    if(sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+JobSystem::Job *JobSystem::take(int self) {
+    if(self >= 0)
+        if(Job *job = deques[self]->Pop()) {
+            queued.fetch_sub(1);
+            return job;
+        }
+    if(queued.load(std::memory_order_relaxed) == 0)
+        return nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if(!shared.empty()) {
+            Job *job = shared.front();
+            shared.pop_front();
+            queued.fetch_sub(1);
+            return job;
+        }
+    }
+    auto count = static_cast<unsigned int>(deques.size());
+    if(count == 0)
+        return nullptr;
+    unsigned int start = nextVictim() % count;
+    for(auto i = 0U; i < count; i++) {
+        unsigned int victim = (start + i) % count;
+        if(static_cast<int>(victim) == self)
+            continue;
+        if(Job *job = deques[victim]->Steal()) {
+            queued.fetch_sub(1);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job *job) {
+    job->fn();
+    JobCounter *counter = job->counter;
+    delete job;
+    // last: a waiter may destroy the counter as soon as it reads zero
+    if(counter)
+        counter->count.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+    currentSystem = this;
+    currentWorker = static_cast<int>(index);
+    int idle = 0;
+    while(!stopping.load(std::memory_order_relaxed)) {
+        if(Job *job = take(static_cast<int>(index))) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if(++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers.fetch_add(1);
+        wake.wait(lock, [&]{ return queued.load() > 0 || stopping.load(); });
+        sleepers.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::Wait(const JobCounter &counter) {
+    int self = currentSystem == this ? currentWorker : -1;
+    while(counter.Pending()) {
+        if(Job *job = take(self))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::splitRange(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &fn, JobCounter &counter) {
+    // hand off the upper half and keep going with the lower one, so the largest pieces are the ones stolen
+    while(end - begin > grain) {
+        size_t mid = begin + (end - begin) / 2;
+        Run([this, mid, end, grain, &fn, &counter]{ splitRange(mid, end, grain, fn, counter); }, &counter);
+        end = mid;
+    }
+    fn(begin, end);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn) {
+    if(count == 0)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    if(count <= grain || workers.empty()) {
+        fn(0, count);
+        return;
+    }
+    JobCounter counter;
+    splitRange(0, count, grain, fn, counter);
+    Wait(counter);
+}
+
+void JobSystem::ParallelSlices(unsigned int slices, size_t count, const std::function<void(size_t, size_t, unsigned int)> &fn) {
+    if(slices <= 1 || count < 2) {
+        fn(0, count, 0U);
+        return;
+    }
+    auto slice = [&](unsigned int s) { fn(count * s / slices, count * (s + 1) / slices, s); };
+    if(workers.empty()) {
+        for(auto s = 0U; s < slices; s++)
+            slice(s);
+        return;
+    }
+    JobCounter counter;
+    for(auto s = 1U; s < slices; s++)
+        Run([&slice, s]{ slice(s); }, &counter);
+    slice(0);
+    Wait(counter);
+}
+
+JobGraph::Node JobGraph::Add(std::function<void()> fn) {
+    nodes.emplace_back();
+    nodes.back().fn = std::move(fn);
+    return nodes.size() - 1;
+}
+
+void JobGraph::Precede(Node before, Node after) {
+    nodes[before].successors.push_back(after);
+    nodes[after].predecessors++;
+}
+
+void JobGraph::Run(JobSystem &jobs) {
+    JobCounter counter;
+    for(auto &node : nodes)
+        node.remaining.store(node.predecessors, std::memory_order_relaxed);
+    for(Node node = 0; node < nodes.size(); node++)
+        if(nodes[node].predecessors == 0)
+            submit(jobs, node, counter);
+    jobs.Wait(counter);
+}
+
+void JobGraph::submit(JobSystem &jobs, Node node, JobCounter &counter) {
+    jobs.Run([this, &jobs, node, &counter]{
+        nodes[node].fn();
+        // successors are submitted before this job retires, so the counter cannot reach zero early
+        for(Node next : nodes[node].successors)
+            if(nodes[next].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                submit(jobs, next, counter);
+    }, &counter);
+}
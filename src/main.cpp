@@ -6,7 +6,11 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <unistd.h>
 
 #include "glm/ext/matrix_transform.hpp"
@@ -14,20 +18,57 @@
 #include "glm/matrix.hpp"
 #include "model.h"
 #include "shader.h"
+#include "programcache.h"
+#ifdef SHADER_HOT_RELOAD
+#include "shaderwatcher.h"
+#endif
+#include "shaderpreprocessor.h"
+#include "shader_reflection.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "camerapath.h"
+#include "fieldgenerator.h"
+#include "bvh.h"
+#include "picking.h"
+#include "physics.h"
+#include "framepipeline.h"
+#include "framepacer.h"
+#include "dynamicresolution.h"
+#include "clusteredlighting.h"
+#include "shadowcascades.h"
+#include "impostor.h"
+#include "particles.h"
+#include "skybox.h"
 #include "camera.h"
 #include "mesh.h"
+#include "framestages.h"
 
 const unsigned int WIDTH = 1366, HEIGHT = 768;
-Camera camera(glm::vec3(0.0, 0.0, 3.0));
 float lastX = WIDTH / 2.0f;
 float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// written by the GLFW callbacks and the debug window, taken by the simulation thread once per frame
+std::mutex inputMutex;
+PendingInput pendingInput;
+
 void processMouse(GLFWwindow*, double, double);
 void processScroll(GLFWwindow*, double, double);
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma);
 
-int main() {
+int main(int argc, char **argv) {
+    BenchOptions bench;
+    if(!ParseBenchOptions(argc, argv, bench))
+        return 1;
+    // keep stdout for the JSON report; everything else logged while benchmarking goes to stderr
+    std::streambuf *stdoutBuffer = std::cout.rdbuf();
+    if(bench.enabled)
+        std::cout.rdbuf(std::cerr.rdbuf());
+    // read before any window, thread or GL object exists, so a bad file has nothing to tear down
+    CameraPath cameraPath;
+    if(!bench.cameraPath.empty() && !cameraPath.Load(bench.cameraPath))
+        return 1;
+
     if(!glfwInit()) {
         std::cerr << "failed to init glfw\n";
         return 1;
@@ -41,7 +82,13 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    // the viewer draws the scene into DynamicResolution's multisampled target and only ImGui and the upscale
+    // into the window, so the window itself needs no samples; the benchmark still draws straight into it
+    const int MSAA_SAMPLES = 4;
+    glfwWindowHint(GLFW_SAMPLES, bench.enabled ? MSAA_SAMPLES : 0);
+    // benchmark runs in a hidden window so it also works on headless boxes under Xvfb and Mesa llvmpipe
+    if(bench.enabled)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     auto *window = glfwCreateWindow(WIDTH, HEIGHT, "OpenGL", nullptr, nullptr);
     if(!window) {
@@ -55,37 +102,30 @@ int main() {
         std::cerr << "failed to init glad\n";
         return 1;
     }
+    // the benchmark always runs unthrottled; the viewer's swap interval is set from the debug window below
+    if(bench.enabled)
+        glfwSwapInterval(0);
+    // unaccelerated, unscaled motion while the cursor is captured for mouse look
+    if(glfwRawMouseMotionSupported())
+        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
 
     glViewport(0, 0, WIDTH, HEIGHT);
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow *window, int width, int height){
         glViewport(0, 0, width, height);
     });
 
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
-
+    // main thread: samples the keys the simulation needs into pendingInput
     auto processInput = [&](GLFWwindow *window){
-        ImGuiIO &io = ImGui::GetIO();
         if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(window, true);
 
-        if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) != GLFW_PRESS)
-            return;
-
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            camera.ProcessKeyboard(FORWARD, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            camera.ProcessKeyboard(BACKWARD, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            camera.ProcessKeyboard(LEFT, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            camera.ProcessKeyboard(RIGHT, deltaTime);
-
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-            camera.SetSpeed(10.0f);
-        else
-            camera.SetSpeed(5.0f);
-
+        std::lock_guard<std::mutex> lock(inputMutex);
+        pendingInput.flying = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+        pendingInput.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+        pendingInput.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+        pendingInput.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+        pendingInput.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+        pendingInput.fast = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
     };
 
     IMGUI_CHECKVERSION();
@@ -94,132 +134,564 @@ int main() {
     ImGui::StyleColorsDark();
 
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_MULTISAMPLE);
     glDepthFunc(GL_LEQUAL);
     glCullFace(GL_BACK);
     glFrontFace(GL_CW);
 
     glfwSetCursorPosCallback(window, processMouse);
     glfwSetScrollCallback(window, processScroll);
-    glfwSetMouseButtonCallback(window, [](GLFWwindow*, int button, int action, int mods){
+    glfwSetMouseButtonCallback(window, [](GLFWwindow *window, int button, int action, int mods){
         ImGuiIO &io = ImGui::GetIO();
         io.AddMouseButtonEvent(button, action == GLFW_PRESS);
         if(io.WantCaptureMouse)
             return;
+        if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+            double x, y;
+            int width, height;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowSize(window, &width, &height);
+            std::lock_guard<std::mutex> lock(inputMutex);
+            pendingInput.pick = true;
+            pendingInput.cursor = glm::vec2(x, y);
+            pendingInput.windowSize = glm::vec2(width, height);
+        }
     });
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
+    // submit every program before loading models so the driver compiles while we parse
+    double shaderStart = glfwGetTime();
+#ifdef SHADER_HOT_RELOAD
+    // development override: compile from the source tree so edits are picked up without rebuilding; files it
+    // cannot open, say once the tree has moved, come from the embedded copies
+    SetShaderSourceOverride(SHADER_SOURCE_DIR);
+#endif
+    ShaderLibrary shaders;
+    Shader &shader = shaders.Get("shaders/vertexShader.glsl", "shaders/fragmentShader.glsl", {"CLUSTERED_LIGHTING", "CASCADED_SHADOWS"});
+    Shader &ringShader = shaders.Get("shaders/vertexShader.glsl", "shaders/fragmentShader.glsl", {"INDEXED_INSTANCE", "CLUSTERED_LIGHTING", "CASCADED_SHADOWS"});
+    Shader &shadowShader = shaders.Get("shaders/shadowVertex.glsl", "");
+    Shader &ringShadowShader = shaders.Get("shaders/shadowVertex.glsl", "", {"INDEXED_INSTANCE"});
+    Shader &impostorBakeShader = shaders.Get("shaders/impostorBakeVertex.glsl", "shaders/impostorBakeFrag.glsl");
+    Shader &impostorShader = shaders.Get("shaders/impostorVertex.glsl", "shaders/impostorFrag.glsl", {"INDEXED_INSTANCE", "CASCADED_SHADOWS"});
+    Shader &lightCullingShader = shaders.GetCompute("shaders/lightCulling.glsl");
+    Shader &particleKickoffShader = shaders.GetCompute("shaders/particleKickoff.glsl");
+    Shader &particleEmitShader = shaders.GetCompute("shaders/particleEmit.glsl");
+    Shader &particleSimulateShader = shaders.GetCompute("shaders/particleSimulate.glsl");
+    Shader &particleShader = shaders.Get("shaders/particleVertex.glsl", "shaders/particleFrag.glsl");
+    Shader &upscaleShader = shaders.Get("shaders/upscaleVertex.glsl", "shaders/upscaleFrag.glsl");
+    Shader &skyboxShader = shaders.Get("shaders/skyboxVertex.glsl", "shaders/skyboxFrag.glsl");
+    std::cout << "shader submit: " << (glfwGetTime() - shaderStart) * 1000.0 << " ms (cache hits: " << ProgramCache::Instance().Hits()
+              << ", misses: " << ProgramCache::Instance().Misses() << ")" << std::endl;
+
+#ifdef SHADER_HOT_RELOAD
+    ShaderWatcher shaderWatcher(SHADER_SOURCE_DIR);
+    shaderWatcher.Watch(shaders);
+#endif
+
+    // the sky faces decode on the job system while the models load; the BC1 blocks cooked on the first run
+    // replace the JPEGs after that
+    Skybox skybox;
+    skybox.Load("textures", "texture_cache/skybox.bc1");
+
     Model planet("models/planet/planet.obj");
     Model rock("models/rock/rock.obj");
 
-    unsigned int amount = 100000;
-    glm::mat4 *modelMatrices = new glm::mat4[amount];
-    srand(glfwGetTime());
-    float radius = 50.0f;
-    float offset = 2.5f;
-    for(auto i = 0U; i < amount; i++) {
-        glm::mat4 model = glm::mat4(1.0);
-        float angle = (float)i / (float)amount * 360.0f;
-        float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float x = sin(angle) * radius + displacement;
-        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float y = displacement * 0.4f;
-        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float z = cos(angle) * radius + displacement;
-        model = glm::translate(model, glm::vec3(x, y, z));
-
-        float scale = (rand() % 20) / 100.0f + 0.05;
-        model = glm::scale(model, glm::vec3(scale));
-
-        float rotAngle = (rand() % 360);
-        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-        modelMatrices[i] = model;
+    // bounding radius of the rock mesh around its origin, scaled per instance into the culling spheres
+    float rockRadius = 0.0f;
+    for(auto &mesh : rock.meshes)
+        for(auto &vertex : mesh.vertices)
+            rockRadius = std::max(rockRadius, glm::length(vertex.Position));
+    MeshRaycaster rockRaycaster(rock.meshes);
+
+    RenderState render(SceneShaders{shader, ringShader, shadowShader, ringShadowShader, impostorShader, lightCullingShader, skyboxShader},
+                       planet, rock, skybox);
+    AsteroidField field;
+
+    // the far field needs the rock's impostor atlas before the first frame, so this one program is waited for
+    {
+        double bakeStart = glfwGetTime();
+        while(impostorBakeShader.IsPending() && !impostorBakeShader.Poll())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        field.impostorsBaked = render.impostorAtlas.Bake(rock, impostorBakeShader, rockRadius);
+        if(field.impostorsBaked)
+            std::cout << "baked " << ImpostorAtlas::GRID * ImpostorAtlas::GRID << " impostor views in "
+                      << (glfwGetTime() - bakeStart) * 1000.0 << " ms" << std::endl;
     }
+    {
+        double skyboxStart = glfwGetTime();
+        if(skybox.Finish())
+            std::cout << "skybox " << (skybox.Compressed() ? "(BC1)" : "(RGB8)") << " uploaded in "
+                      << (glfwGetTime() - skyboxStart) * 1000.0 << " ms" << std::endl;
+    }
+
+    // the generator threads write straight into the mapped buffer, there is no staging copy
+    auto uploadAsteroids = [&](unsigned int count, uint32_t seed) {
+        double start = glfwGetTime();
+        glBindBuffer(GL_ARRAY_BUFFER, render.instanceMatrices);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW);
+        auto *matrices = static_cast<glm::mat4 *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if(!matrices) {
+            std::cerr << "failed to map asteroid buffer for " << count << " instances" << std::endl;
+            field.count = render.asteroids = 0;
+            return;
+        }
+        field.bounds.resize(count);
+        FieldGenerator(seed).Generate(matrices, count, 0, field.bounds.data());
+        if(!glUnmapBuffer(GL_ARRAY_BUFFER))
+            std::cerr << "asteroid buffer was lost while mapped" << std::endl;
+        field.count = render.asteroids = count;
+        field.seed = seed;
+        std::cout << "generated " << count << " asteroids in " << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+
+        start = glfwGetTime();
+        for(auto &sphere : field.bounds)
+            sphere.w *= rockRadius;
+        field.index.Build(field.bounds.data(), count);
+        field.shadows.Invalidate();
+        std::vector<uint32_t> ids(count);
+        for(auto i = 0U; i < count; i++)
+            ids[i] = i;
+        glBindBuffer(GL_ARRAY_BUFFER, render.allInstances);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(uint32_t), ids.data(), GL_STATIC_DRAW);
+        std::cout << "indexed " << count << " asteroids in " << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+    };
+    uploadAsteroids(100000, bench.seed);
+
+    // Point lights drifting along the ring, each on its own circular orbit. Orbits come from the seed, so a
+    // benchmark run sees the same lights at the same time for any light count prefix.
+    struct RingLight {
+        float radius, height, phase, speed;
+        glm::vec4 colorIntensity;
+    };
+    std::vector<RingLight> ringLights;
+    std::vector<PointLight> pointLights;
+    auto spawnLights = [&](unsigned int count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        FieldParams ring;
+        ringLights.resize(std::min(count, ClusteredLighting::MAX_LIGHTS));
+        for(auto &light : ringLights) {
+            light.radius = ring.radius + (unit(rng) * 2.0f - 1.0f) * ring.offset * 1.5f;
+            light.height = (unit(rng) * 2.0f - 1.0f) * ring.offset;
+            light.phase = unit(rng) * 2.0f * glm::pi<float>();
+            light.speed = (0.02f + 0.08f * unit(rng)) * (unit(rng) < 0.5f ? -1.0f : 1.0f);
+            glm::vec3 color = glm::mix(glm::vec3(1.0f, 0.55f, 0.2f), glm::vec3(0.3f, 0.6f, 1.0f), unit(rng));
+            light.colorIntensity = glm::vec4(color, 4.0f + 8.0f * unit(rng));
+        }
+    };
+    // moves the lights to where they are at `time` seconds and uploads them
+    auto animateLights = [&](float time) {
+        PROFILE_CPU_SCOPE("lights");
+        pointLights.resize(ringLights.size());
+        for(auto i = 0U; i < ringLights.size(); i++) {
+            auto &light = ringLights[i];
+            float angle = light.phase + light.speed * time;
+            // ranges vary per light so clusters see a mix of overlap counts
+            float range = 3.0f + 3.0f * (i % 4) / 3.0f;
+            pointLights[i] = {glm::vec4(std::sin(angle) * light.radius, light.height, std::cos(angle) * light.radius, range), light.colorIntensity};
+        }
+        render.lighting.SetLights(pointLights);
+    };
+    spawnLights(bench.lights, bench.seed);
 
-    Shader shader("shaders/vertexShader.glsl", "shaders/fragmentShader.glsl");
-    Shader ringShader("shaders/vertexShaderRing.glsl", "shaders/fragmentShader.glsl");
-
-    unsigned int buffer;
-    glGenBuffers(1, &buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-    for (auto i = 0U; i < rock.meshes.size(); i++) {
-        unsigned int VAO = rock.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
+    // debris and dust orbiting with the ring, simulated and drawn on the GPU by the viewer (not the benchmark)
+    ParticleSystem particles;
+    {
+        FieldParams field;
+        ParticleEmitter debris;
+        debris.rate = 20000.0f;
+        debris.innerRadius = field.radius - field.offset * 1.5f;
+        debris.outerRadius = field.radius + field.offset * 1.5f;
+        debris.thickness = field.offset * field.heightScale;
+        debris.speedJitter = 0.02f;
+        debris.color = glm::vec4(0.8f, 0.7f, 0.6f, 0.5f);
+        debris.minLife = 10.0f;
+        debris.maxLife = 20.0f;
+        debris.minSize = 0.02f;
+        debris.maxSize = 0.06f;
+        ParticleEmitter dust = debris;
+        dust.rate = 100000.0f;
+        dust.innerRadius = field.radius - field.offset * 3.0f;
+        dust.outerRadius = field.radius + field.offset * 3.0f;
+        dust.thickness = field.offset;
+        dust.speedJitter = 0.05f;
+        dust.color = glm::vec4(0.5f, 0.6f, 0.8f, 0.08f);
+        dust.minSize = 0.05f;
+        dust.maxSize = 0.15f;
+        particles.Emitters() = {debris, dust};
     }
 
+    if(bench.enabled) {
+        // wait for every program to link so compile time does not land in the measurements
+        while(shaders.Poll())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        Camera benchCamera;
+        std::vector<BenchResult> results;
+        std::vector<uint32_t> visible, impostors;
+        ShadowFrame shadow;
+        std::vector<uint32_t> casters[SHADOW_CASCADES];
+        glm::vec3 sun = SunDirection(PendingInput().sunAzimuth, PendingInput().sunElevation);
+        auto run = [&](unsigned int count, unsigned int lights) {
+            uploadAsteroids(count, bench.seed);
+            spawnLights(lights, bench.seed);
+            BenchResult result;
+            result.asteroids = count;
+            result.lights = static_cast<unsigned int>(ringLights.size());
+            // one GL_TIME_ELAPSED query per frame, read back once the run is over so nothing waits on the GPU mid-run
+            std::vector<unsigned int> queries(bench.frames);
+            glGenQueries(bench.frames, queries.data());
+            for(auto frame = 0U; frame < bench.warmup + bench.frames; frame++) {
+                bool measured = frame >= bench.warmup;
+                auto index = measured ? frame - bench.warmup : 0;
+                double start = glfwGetTime();
+                if(measured)
+                    glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+                glm::mat4 view = BenchCameraView(float(index) / bench.frames);
+                if(!cameraPath.Empty()) {
+                    cameraPath.Apply(index * CameraPath::REPLAY_STEP, benchCamera, true);
+                    view = benchCamera.GetViewMatrix();
+                }
+                glm::mat4 projection = glm::perspective(glm::radians(benchCamera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 10000.0f);
+                animateLights(index * CameraPath::REPLAY_STEP);
+                CullAsteroids(field, projection, view, PendingInput().impostorDistance, visible, impostors);
+                PlanShadows(field, view, benchCamera.Zoom, (float)WIDTH / (float)HEIGHT, sun, true, shadow, casters);
+                RenderShadows(render, shadow, casters);
+                SceneStats stats = DrawScene(render, projection, view, &visible, &impostors, shadow, false);
+                if(measured)
+                    glEndQuery(GL_TIME_ELAPSED);
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+                if(measured) {
+                    result.cpuMs.push_back((glfwGetTime() - start) * 1000.0);
+                    result.drawCalls = stats.drawCalls;
+                    result.triangles = stats.triangles;
+                    result.overflowClusters = std::max(result.overflowClusters, render.lighting.OverflowClusters());
+                }
+            }
+            glFinish();
+            for(auto query : queries) {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                result.gpuMs.push_back(elapsed / 1e6);
+            }
+            glDeleteQueries(bench.frames, queries.data());
+            std::cerr << "bench: " << count << " asteroids, " << result.lights << " lights, p50 " << Percentile(result.cpuMs, 50.0)
+                      << " ms, " << result.overflowClusters << " overflowing clusters" << std::endl;
+            results.push_back(std::move(result));
+        };
+        for(auto count : bench.counts)
+            run(count, bench.lights);
+        // light cost on its own, over the lightest asteroid load of the sweep above
+        for(auto lights : bench.lightCounts)
+            run(*std::min_element(bench.counts.begin(), bench.counts.end()), lights);
+
+        std::cout.rdbuf(stdoutBuffer);
+        auto renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+        bool written = WriteBenchReport(bench, results, renderer ? renderer : "");
+        glfwTerminate();
+        return written ? 0 : 1;
+    }
+
+    const std::string cameraPathFile = bench.cameraPath.empty() ? "camera.path" : bench.cameraPath;
+
+    // the first PHYSICS_BODIES instances (a contiguous arc of the ring) become rigid bodies; their
+    // interpolated matrices overwrite the front of the instance buffer every frame
+    const unsigned int PHYSICS_BODIES = 20000;
+    AsteroidPhysics physics;
+    // the simulation thread owns sim, and through it the field, the camera and the camera path, until it is joined
+    SimulationState sim(field, physics, rockRaycaster, cameraPath, cameraPathFile, (float)WIDTH / (float)HEIGHT);
+    {
+        unsigned int bodies = std::min(field.count, PHYSICS_BODIES);
+        std::vector<glm::mat4> transforms(bodies);
+        std::vector<float> radii(bodies);
+        FieldGenerator(field.seed).GenerateRange(transforms.data(), 0, bodies, field.count);
+        for(auto i = 0U; i < bodies; i++) {
+            radii[i] = field.bounds[i].w;
+            sim.physicsInstances.push_back(i);
+        }
+        physics.Start(transforms, radii);
+    }
+
+    FramePipeline<FramePacket> pipeline;
+    std::thread simulation([&] {
+        sim.lastTime = glfwGetTime();
+        while(FramePacket *packet = pipeline.Begin()) {
+            PROFILE_CPU_SCOPE("simulate");
+            PendingInput input;
+            {
+                std::lock_guard<std::mutex> lock(inputMutex);
+                input = pendingInput;
+                pendingInput.look = glm::vec2(0.0f);
+                pendingInput.scroll = 0.0f;
+                pendingInput.pick = pendingInput.record = pendingInput.stopRecording = false;
+                pendingInput.replay = pendingInput.stopReplay = pendingInput.savePath = pendingInput.loadPath = false;
+            }
+            SimulateFrame(sim, input, *packet);
+            pipeline.Submit();
+        }
+    });
+
+    // Render thread (the main thread, which owns the GL context, GLFW and ImGui): draws packet N while the
+    // simulation builds N + 1
+    double renderMs = 0.0;
+    Profiler &profiler = Profiler::Instance();
+
+    // Frame pacing: the swap interval, a cap on frames queued ahead of the GPU, and late latching, which
+    // polls once more just before the view matrix is set and turns the packet's camera by the mouse motion
+    // the simulation has not consumed yet. Culling used the packet's frustum, so a fast flick can show the
+    // edge of it for a frame.
+    struct PacingSettings {
+        int swapInterval = 1;
+        bool rawMouse = true;
+        bool lateLatch = true;
+        int limit = static_cast<int>(FramePacer::Limit::Fence);
+        int maxQueued = 1;
+    };
+    PacingSettings pacing;
+    bool particlesEnabled = true;
+    double particleTime = glfwGetTime();
+    FramePacer pacer;
+    glfwSwapInterval(pacing.swapInterval);
+    pacer.SetLimit(static_cast<FramePacer::Limit>(pacing.limit), pacing.maxQueued);
+    const GLFWvidmode *videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    double refreshMs = videoMode && videoMode->refreshRate > 0 ? 1000.0 / videoMode->refreshRate : 1000.0 / 60.0;
+
+    // the viewer renders the scene offscreen at a scale that keeps its GPU time on budget; ImGui stays native
+    DynamicResolution resolution;
+    resolution.Params().targetMs = bench.targetMs > 0.0f ? bench.targetMs : static_cast<float>(refreshMs);
     while(!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-        processInput(window);
-
-        auto currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 10000.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
-
-        shader.Use();
-        shader.SetMat4("projection", projection);
-        shader.SetMat4("view", view);
-        shader.SetMat4("model", model);
-
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        planet.Draw(shader);
-
-        ringShader.Use();
-        ringShader.SetMat4("projection", projection);
-        ringShader.SetMat4("view", view);
-        for(auto i = 0U; i < rock.meshes.size(); i++) {
-            glBindVertexArray(rock.meshes[i].VAO);
-            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rock.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, amount);
-            glBindVertexArray(0);
+        profiler.BeginFrame();
+        size_t shadersCompiling;
+        {
+            PROFILE_CPU_SCOPE("input");
+            glfwPollEvents();
+            processInput(window);
+#ifdef SHADER_HOT_RELOAD
+            shaderWatcher.Update();
+#endif
+            shadersCompiling = shaders.Poll();
+        }
+
+        const FramePacket *packet;
+        {
+            PROFILE_CPU_SCOPE("wait for simulation");
+            packet = pipeline.Acquire(std::chrono::milliseconds(100));
+        }
+        if(!packet) {
+            profiler.EndFrame();
+            continue;
         }
+        double renderStart = glfwGetTime();
+        uint64_t depth = pipeline.Depth();
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+        if(!packet->physicsMatrices.empty()) {
+            PROFILE_SCOPE("physics upload");
+            glBindBuffer(GL_ARRAY_BUFFER, render.instanceMatrices);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, packet->physicsMatrices.size() * sizeof(glm::mat4), packet->physicsMatrices.data());
+        }
+        {
+            PROFILE_CPU_SCOPE("frame limiter");
+            pacer.Throttle();
+        }
+        glm::mat4 view = packet->view;
+        if(pacing.lateLatch && packet->lateLatch) {
+            PROFILE_CPU_SCOPE("late latch");
+            glfwPollEvents();
+            glm::vec2 look;
+            {
+                std::lock_guard<std::mutex> lock(inputMutex);
+                look = pendingInput.look;
+            }
+            if(look != glm::vec2(0.0f)) {
+                Camera latched = packet->camera;
+                latched.ProcessMouseMovement(look.x, look.y);
+                view = latched.GetViewMatrix();
+            }
+        }
+        pacer.LatchInput();
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        resolution.Resize(framebufferWidth, framebufferHeight, MSAA_SAMPLES);
+        resolution.Update();
+        RenderShadows(render, packet->shadow, packet->shadowCasters);
+        {
+            // a long stall advances the particles by at most a tenth of a second, like the simulation's step cap
+            double now = glfwGetTime();
+            auto particleStep = static_cast<float>(std::min(now - particleTime, 0.1));
+            particleTime = now;
+            if(particlesEnabled) {
+                PROFILE_SCOPE("particle simulation");
+                particles.Simulate(particleKickoffShader, particleEmitShader, particleSimulateShader, particleStep);
+            }
+        }
+        resolution.Begin();
+        animateLights(static_cast<float>(glfwGetTime()));
+        SceneStats stats = DrawScene(render, packet->projection, view, packet->culled ? &packet->visible : nullptr,
+                                     packet->culled ? &packet->impostors : nullptr, packet->shadow, true);
+        if(particlesEnabled) {
+            PROFILE_SCOPE("particles");
+            particles.Draw(particleShader, packet->projection, view);
+        }
         {
-            static float f = 0.0f;
-            ImGui::Begin("Debug", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
-            ImGui::Text("Position: %.1f, %.1f, %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
-            ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
-            ImGui::End();
+            PROFILE_SCOPE("upscale");
+            resolution.End(upscaleShader);
         }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_SCOPE("imgui");
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            {
+                // widgets edit a copy of the settings; changes and button presses go to the simulation as input
+                PendingInput settings;
+                {
+                    std::lock_guard<std::mutex> lock(inputMutex);
+                    settings = pendingInput;
+                }
+                ImGui::Begin("Debug", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+                ImGui::Text("Position: %.1f, %.1f, %.1f", packet->cameraPosition.x, packet->cameraPosition.y, packet->cameraPosition.z);
+                ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+                ImGui::Text("Pipeline: frame %llu, depth %llu, simulation %.2f ms, render %.2f ms",
+                            static_cast<unsigned long long>(packet->index), static_cast<unsigned long long>(depth), packet->simMs, renderMs);
+                ImGui::Text("Simulation: %u steps this frame at %.0f Hz", packet->simSteps, 1.0 / SimulationState::STEP);
+                ImGui::Text("Shaders compiling: %zu/%zu", shadersCompiling, shaders.ProgramCount());
+                ImGui::Text("Shader variants: %zu (%zu programs)", shaders.VariantCount(), shaders.ProgramCount());
+                if(ImGui::CollapsingHeader("Dynamic resolution")) {
+                    bool dynamic = resolution.Enabled();
+                    if(ImGui::Checkbox("Enabled", &dynamic))
+                        resolution.SetEnabled(dynamic);
+                    ImGui::SliderFloat("Target GPU ms", &resolution.Params().targetMs, 2.0f, 50.0f, "%.1f");
+                    ImGui::Text("Scale %.2f: %dx%d, scene GPU %.2f ms", resolution.Scale(), resolution.ScaledWidth(),
+                                resolution.ScaledHeight(), resolution.GpuMs());
+                }
+                if(ImGui::CollapsingHeader("Lighting")) {
+                    int lightCount = static_cast<int>(ringLights.size());
+                    if(ImGui::SliderInt("Point lights", &lightCount, 0, ClusteredLighting::MAX_LIGHTS))
+                        spawnLights(static_cast<unsigned int>(lightCount), bench.seed);
+                    ImGui::Text("%u lights binned into %ux%ux%u clusters", render.lighting.LightCount(), ClusteredLighting::GRID_X,
+                                ClusteredLighting::GRID_Y, ClusteredLighting::GRID_Z);
+                    ImGui::Text("Overflow: %u clusters past %u lights, %u light references dropped", render.lighting.OverflowClusters(),
+                                ClusteredLighting::MAX_LIGHTS_PER_CLUSTER, render.lighting.DroppedLights());
+                }
+                if(ImGui::CollapsingHeader("Particles")) {
+                    ImGui::Checkbox("Simulate and draw", &particlesEnabled);
+                    ImGui::Text("%u/%u alive, %u emitted last frame, simulation %.2f ms GPU", particles.Alive(), particles.Capacity(),
+                                particles.Emitted(), particles.GpuMs());
+                    float capacity = particles.Capacity() / 1e6f;
+                    ImGui::SliderFloat("Capacity (millions)", &capacity, 0.25f, 8.0f, "%.2f");
+                    // reallocating drops every particle, so only once the slider is let go
+                    if(ImGui::IsItemDeactivatedAfterEdit())
+                        particles.SetCapacity(static_cast<unsigned int>(capacity * 1e6f));
+                    for(auto i = 0U; i < particles.Emitters().size(); i++) {
+                        ImGui::PushID(static_cast<int>(i));
+                        ImGui::SliderFloat("Emitter rate", &particles.Emitters()[i].rate, 0.0f, 500000.0f, "%.0f/s");
+                        ImGui::PopID();
+                    }
+                }
+                if(ImGui::CollapsingHeader("Shadows")) {
+                    ImGui::Checkbox("Sun shadows", &settings.shadows);
+                    ImGui::SameLine();
+                    ImGui::Checkbox("Cache far cascades", &settings.cacheShadows);
+                    ImGui::SliderFloat("Sun azimuth", &settings.sunAzimuth, -180.0f, 180.0f, "%.0f");
+                    ImGui::SliderFloat("Sun elevation", &settings.sunElevation, -10.0f, 90.0f, "%.0f");
+                    for(auto i = 0U; i < SHADOW_CASCADES; i++) {
+                        const ShadowCascade &cascade = packet->shadow.cascades[i];
+                        if(cascade.dirty)
+                            ImGui::Text("Cascade %u: to %.0f, rendered with %zu asteroids", i, cascade.splitDepth, packet->shadowCasters[i].size());
+                        else
+                            ImGui::Text("Cascade %u: to %.0f, cached", i, cascade.splitDepth);
+                    }
+                }
+                if(ImGui::CollapsingHeader("Frame pacing")) {
+                    ImGui::Text("Estimated input latency %.1f ms, limiter wait %.2f ms, %zu frames queued",
+                                pacer.LatencyMs(), pacer.ThrottleMs(), pacer.Queued());
+                    if(ImGui::SliderInt("Swap interval", &pacing.swapInterval, 0, 2))
+                        glfwSwapInterval(pacing.swapInterval);
+                    if(glfwRawMouseMotionSupported() && ImGui::Checkbox("Raw mouse motion", &pacing.rawMouse))
+                        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, pacing.rawMouse ? GLFW_TRUE : GLFW_FALSE);
+                    ImGui::Checkbox("Late latch mouse look", &pacing.lateLatch);
+                    bool limitChanged = ImGui::Combo("Frame limiter", &pacing.limit, "Off\0Fence\0glFinish\0");
+                    if(pacing.limit == static_cast<int>(FramePacer::Limit::Fence))
+                        limitChanged |= ImGui::SliderInt("Max queued frames", &pacing.maxQueued, 0, 3);
+                    if(limitChanged)
+                        pacer.SetLimit(static_cast<FramePacer::Limit>(pacing.limit), pacing.maxQueued);
+                }
+                ImGui::Checkbox("Frustum culling", &settings.frustumCulling);
+                ImGui::SameLine();
+                ImGui::Text("%u/%u asteroids drawn, %u as impostors", stats.asteroids + stats.impostors, render.asteroids, stats.impostors);
+                ImGui::Checkbox("Impostors", &settings.impostors);
+                ImGui::SameLine();
+                ImGui::SliderFloat("Impostor distance", &settings.impostorDistance, 10.0f, 300.0f, "%.0f");
+                bool physicsRunning = !physics.Paused();
+                if(ImGui::Checkbox("Physics", &physicsRunning))
+                    physics.SetPaused(!physicsRunning);
+                ImGui::SameLine();
+                ImGui::Text("%zu bodies, step %.2f ms", physics.BodyCount(), physics.StepMs());
+                if(packet->picked)
+                    ImGui::Text("Selected asteroid %u: mesh %u, triangle %u, %.2f away (picked in %.3f ms)",
+                                packet->pick.instance, packet->pick.mesh, packet->pick.triangle, packet->pick.distance, packet->pickMs);
+                else
+                    ImGui::Text("Selected asteroid: none (left click to pick)");
+                bool record = false, stopRecording = false, replay = false, stopReplay = false, savePath = false, loadPath = false;
+                if(ImGui::CollapsingHeader("Camera path")) {
+                    ImGui::Text("%zu keys, %.1f s", packet->pathKeys, packet->pathDuration);
+                    if(packet->pathMode == PathMode::Recording)
+                        stopRecording = ImGui::Button("Stop recording");
+                    else
+                        record = ImGui::Button("Record");
+                    ImGui::SameLine();
+                    if(packet->pathMode == PathMode::Replaying)
+                        stopReplay = ImGui::Button("Stop replay");
+                    else
+                        replay = ImGui::Button("Replay");
+                    ImGui::SameLine();
+                    ImGui::Checkbox("Loop", &settings.loopReplay);
+                    savePath = ImGui::Button("Save");
+                    ImGui::SameLine();
+                    loadPath = ImGui::Button("Load");
+                }
+                ImGui::End();
+                profiler.DrawImGui();
+
+                std::lock_guard<std::mutex> lock(inputMutex);
+                pendingInput.frustumCulling = settings.frustumCulling;
+                pendingInput.loopReplay = settings.loopReplay;
+                pendingInput.shadows = settings.shadows;
+                pendingInput.cacheShadows = settings.cacheShadows;
+                pendingInput.sunAzimuth = settings.sunAzimuth;
+                pendingInput.sunElevation = settings.sunElevation;
+                pendingInput.impostors = settings.impostors;
+                pendingInput.impostorDistance = settings.impostorDistance;
+                pendingInput.record |= record;
+                pendingInput.stopRecording |= stopRecording;
+                pendingInput.replay |= replay;
+                pendingInput.stopReplay |= stopReplay;
+                pendingInput.savePath |= savePath;
+                pendingInput.loadPath |= loadPath;
+            }
+
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
         if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE)
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        renderMs = (glfwGetTime() - renderStart) * 1000.0;
 
-        glfwSwapBuffers(window);
+        {
+            PROFILE_CPU_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+        // with vsync the frame waits for the next vblank and is then scanned out, about one refresh on average
+        pacer.EndFrame(pacing.swapInterval > 0 ? refreshMs * pacing.swapInterval : 0.0);
+        profiler.EndFrame();
     }
 
-    delete[] modelMatrices;
-
+    pipeline.Close();
+    simulation.join();
+    physics.Stop();
     glfwTerminate();
     return 0;
 }
@@ -249,7 +721,8 @@ void processMouse(GLFWwindow *window, double xPosIn, double yPosIn)
 
     if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        camera.ProcessMouseMovement(xOffset, yOffset);
+        std::lock_guard<std::mutex> lock(inputMutex);
+        pendingInput.look += glm::vec2(xOffset, yOffset);
     }
 }
 
@@ -260,7 +733,8 @@ void processScroll(GLFWwindow *, double xOffset, double yOffset)
     if(io.WantCaptureMouse)
         return;
 
-    camera.ProcessMouseScroll(static_cast<float>(yOffset));
+    std::lock_guard<std::mutex> lock(inputMutex);
+    pendingInput.scroll += static_cast<float>(yOffset);
 }
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
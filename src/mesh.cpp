@@ -1,10 +1,14 @@
 #include "mesh.h"
+#include "shader_reflection.h"
 #include <glad/glad.h>
 
+namespace attrib = shader_reflection::vertexShader::attrib;
+namespace shadowAttrib = shader_reflection::shadowVertex::attrib;
+
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->textures = std::move(textures);
 
     setupMesh();
 }
@@ -21,14 +25,28 @@ void Mesh::setupMesh() {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(attrib::aPos);
+    glVertexAttribPointer(attrib::aPos, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+    glEnableVertexAttribArray(attrib::aNormal);
+    glVertexAttribPointer(attrib::aNormal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(attrib::aTexCoords);
+    glVertexAttribPointer(attrib::aTexCoords, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    // a third of the interleaved vertex size, so shadow passes fetch less per vertex
+    std::vector<glm::vec3> positions(vertices.size());
+    for(auto i = 0U; i < vertices.size(); i++)
+        positions[i] = vertices[i].Position;
+    glGenVertexArrays(1, &positionVAO);
+    glGenBuffers(1, &positionVBO);
+    glBindVertexArray(positionVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glEnableVertexAttribArray(shadowAttrib::aPos);
+    glVertexAttribPointer(shadowAttrib::aPos, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glBindVertexArray(0);
 }
 
 void Mesh::Draw(Shader &shader) {
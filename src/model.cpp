@@ -13,6 +13,12 @@ void Model::Draw(Shader &shader) {
 }
 
 void Model::loadModel(std::string path) {
+    // Wavefront files take the native multithreaded path, everything else goes through Assimp
+    if(path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0) {
+        loadObj(path);
+        return;
+    }
+
     Assimp::Importer importer;
     const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
@@ -25,6 +31,18 @@ void Model::loadModel(std::string path) {
     processNode(scene->mRootNode, scene);
 }
 
+void Model::loadObj(const std::string &path) {
+    ObjScene scene;
+    if(!LoadObj(path, scene)) {
+        std::cerr << "obj error: failed to load " << path << std::endl;
+        return;
+    }
+
+    directory = path.substr(0, path.find_last_of('/'));
+    for(auto &mesh : scene.meshes)
+        meshes.push_back(processObjMesh(mesh, scene));
+}
+
 void Model::processNode(aiNode *node, const aiScene *scene) {
     for(auto i = 0U; i < node->mNumMeshes; i++) {
         aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
@@ -75,28 +93,40 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
     return Mesh(vertices, indices, textures);
 }
 
+Mesh Model::processObjMesh(ObjMesh &mesh, const ObjScene &scene) {
+    std::vector<Texture> textures;
+
+    if(mesh.material >= 0) {
+        const ObjMaterial &material = scene.materials[mesh.material];
+        if(!material.diffuseMap.empty())
+            textures.emplace_back(loadTexture(material.diffuseMap, "texture_diffuse"));
+        if(!material.specularMap.empty())
+            textures.emplace_back(loadTexture(material.specularMap, "texture_specular"));
+    }
+
+    return Mesh(std::move(mesh.vertices), std::move(mesh.indices), textures);
+}
+
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
     std::vector<Texture> textures;
     for(auto i = 0U; i < mat->GetTextureCount(type); i++) {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for(auto j = 0U; j < textures_loaded.size(); j++) {
-            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                textures.emplace_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-
-        if(skip) continue;
-
-        Texture texture;
-        texture.id = TextureFromFile(str.C_Str(), directory);
-        texture.type = typeName;
-        texture.path = str.C_Str();
-        textures.emplace_back(texture);
-        textures_loaded.push_back(texture);
+        textures.emplace_back(loadTexture(str.C_Str(), typeName));
     }
     return textures;
+}
+
+Texture Model::loadTexture(const std::string &path, const std::string &typeName) {
+    for(auto j = 0U; j < textures_loaded.size(); j++) {
+        if(textures_loaded[j].path == path)
+            return textures_loaded[j];
+    }
+
+    Texture texture;
+    texture.id = TextureFromFile(path.c_str(), directory);
+    texture.type = typeName;
+    texture.path = path;
+    textures_loaded.push_back(texture);
+    return texture;
 }
\ No newline at end of file
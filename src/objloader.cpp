@@ -0,0 +1,464 @@
+#include "objloader.h"
+#include "jobsystem.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t MISSING = 0xFFFFFFFFu;
+
+// Position, texcoord and normal index of one face corner, 0-based
+struct ObjCorner {
+    uint32_t idx[3];
+};
+
+struct ObjGroup {
+    size_t firstCorner;
+    std::string material;
+};
+
+// Everything parsed out of one line-aligned slice of the file. Negative (relative) indices are stored
+// relative to the start of the chunk and patched once the global element counts are known.
+struct ObjChunk {
+    std::vector<glm::vec3>   positions;
+    std::vector<glm::vec2>   texCoords;
+    std::vector<glm::vec3>   normals;
+    std::vector<ObjCorner>   corners;
+    std::vector<size_t>      fixups;
+    std::vector<ObjGroup>    groups;
+    std::vector<std::string> mtllibs;
+};
+
+const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char *skipSpace(const char *p, const char *end) {
+    while(p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+// Decimal float parser for the restricted syntax OBJ exporters write ([-]digits[.digits][e[-]digits])
+const char *parseFloat(const char *p, const char *end, float &out) {
+    p = skipSpace(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for(; p < end && isDigit(*p); p++) {
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if(p < end && *p == '.') {
+        for(p++; p < end && isDigit(*p); p++) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool expNegative = false;
+        if(p < end && (*p == '-' || *p == '+'))
+            expNegative = *p++ == '-';
+        int e = 0;
+        for(; p < end && isDigit(*p); p++)
+            e = e < 10000 ? e * 10 + (*p - '0') : e;
+        exponent += expNegative ? -e : e;
+    }
+
+    double value = static_cast<double>(mantissa);
+    while(exponent > 0) {
+        int step = exponent > 22 ? 22 : exponent;
+        value *= POW10[step];
+        exponent -= step;
+    }
+    while(exponent < 0) {
+        int step = -exponent > 22 ? 22 : -exponent;
+        value /= POW10[step];
+        exponent += step;
+    }
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+const char *parseInt(const char *p, const char *end, long &out) {
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    long value = 0;
+    for(; p < end && isDigit(*p); p++)
+        value = value * 10 + (*p - '0');
+    out = negative ? -value : value;
+    return p;
+}
+
+std::string trimmed(const char *p, const char *end) {
+    p = skipSpace(p, end);
+    while(end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+    return std::string(p, end);
+}
+
+inline bool startsWith(const char *p, const char *end, const char *keyword) {
+    size_t length = std::strlen(keyword);
+    return static_cast<size_t>(end - p) > length && std::memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to 0-based. Relative indices are resolved against
+// the chunk-local element count and flagged in `relative` so the chunk base can be added after the merge.
+inline uint32_t resolveIndex(long raw, size_t localCount, int component, unsigned int &relative) {
+    if(raw > 0)
+        return static_cast<uint32_t>(raw - 1);
+    if(raw == 0)
+        return MISSING;
+    relative |= 1U << component;
+    return static_cast<uint32_t>(static_cast<int32_t>(static_cast<long>(localCount) + raw));
+}
+
+const char *parseCorner(const char *p, const char *end, const ObjChunk &chunk, ObjCorner &corner, unsigned int &relative) {
+    long raw[3] = {0, 0, 0};
+    p = parseInt(p, end, raw[0]);
+    if(p < end && *p == '/') {
+        p++;
+        if(p < end && *p != '/')
+            p = parseInt(p, end, raw[1]);
+        if(p < end && *p == '/')
+            p = parseInt(p + 1, end, raw[2]);
+    }
+
+    relative = 0;
+    corner.idx[0] = resolveIndex(raw[0], chunk.positions.size(), 0, relative);
+    corner.idx[1] = resolveIndex(raw[1], chunk.texCoords.size(), 1, relative);
+    corner.idx[2] = resolveIndex(raw[2], chunk.normals.size(), 2, relative);
+    return p;
+}
+
+void pushCorner(ObjChunk &chunk, const ObjCorner &corner, unsigned int relative) {
+    for(auto k = 0U; relative && k < 3; k++)
+        if(relative & (1U << k))
+            chunk.fixups.push_back(chunk.corners.size() * 3 + k);
+    chunk.corners.push_back(corner);
+}
+
+void parseChunk(const char *p, const char *end, ObjChunk &chunk) {
+    while(p < end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if(!lineEnd)
+            lineEnd = end;
+        const char *line = skipSpace(p, lineEnd);
+        p = lineEnd + 1;
+
+        if(line + 1 >= lineEnd)
+            continue;
+
+        if(line[0] == 'v') {
+            if(line[1] == ' ' || line[1] == '\t') {
+                glm::vec3 position;
+                line = parseFloat(line + 1, lineEnd, position.x);
+                line = parseFloat(line, lineEnd, position.y);
+                parseFloat(line, lineEnd, position.z);
+                chunk.positions.emplace_back(position);
+            } else if(line[1] == 't') {
+                glm::vec2 texCoord;
+                line = parseFloat(line + 2, lineEnd, texCoord.x);
+                parseFloat(line, lineEnd, texCoord.y);
+                chunk.texCoords.emplace_back(texCoord);
+            } else if(line[1] == 'n') {
+                glm::vec3 normal;
+                line = parseFloat(line + 2, lineEnd, normal.x);
+                line = parseFloat(line, lineEnd, normal.y);
+                parseFloat(line, lineEnd, normal.z);
+                chunk.normals.emplace_back(normal);
+            }
+        } else if(line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+            // fan-triangulate polygons, like aiProcess_Triangulate does for convex faces
+            ObjCorner first, previous, current;
+            unsigned int firstRelative = 0, previousRelative = 0, currentRelative = 0;
+            int count = 0;
+            line = skipSpace(line + 1, lineEnd);
+            while(line < lineEnd && *line != '\r') {
+                const char *next = skipSpace(parseCorner(line, lineEnd, chunk, current, currentRelative), lineEnd);
+                if(next == line)
+                    break;
+                line = next;
+                if(count >= 2) {
+                    pushCorner(chunk, first, firstRelative);
+                    pushCorner(chunk, previous, previousRelative);
+                    pushCorner(chunk, current, currentRelative);
+                } else if(count == 0) {
+                    first = current;
+                    firstRelative = currentRelative;
+                }
+                previous = current;
+                previousRelative = currentRelative;
+                count++;
+            }
+        } else if(startsWith(line, lineEnd, "usemtl")) {
+            chunk.groups.push_back({chunk.corners.size(), trimmed(line + 6, lineEnd)});
+        } else if(startsWith(line, lineEnd, "mtllib")) {
+            chunk.mtllibs.push_back(trimmed(line + 6, lineEnd));
+        }
+    }
+}
+
+void loadMtl(const std::string &path, ObjScene &scene, std::unordered_map<std::string, int> &materialIndex) {
+    std::ifstream file(path);
+    if(!file) {
+        std::cerr << "failed to open material library: " << path << std::endl;
+        return;
+    }
+
+    std::string line;
+    ObjMaterial *material = nullptr;
+    while(std::getline(file, line)) {
+        const char *begin = line.data();
+        const char *end = begin + line.size();
+        begin = skipSpace(begin, end);
+        // texture statements may carry options (-bm 1.0 file.png), the file name is always the last token
+        auto lastToken = [&](const char *p){
+            std::string value = trimmed(p, end);
+            auto space = value.find_last_of(" \t");
+            return space == std::string::npos ? value : value.substr(space + 1);
+        };
+
+        if(startsWith(begin, end, "newmtl")) {
+            std::string name = trimmed(begin + 6, end);
+            materialIndex[name] = static_cast<int>(scene.materials.size());
+            scene.materials.push_back({name, "", ""});
+            material = &scene.materials.back();
+        } else if(material && startsWith(begin, end, "map_Kd")) {
+            material->diffuseMap = lastToken(begin + 6);
+        } else if(material && startsWith(begin, end, "map_Ks")) {
+            material->specularMap = lastToken(begin + 6);
+        }
+    }
+}
+
+inline uint64_t hashCorner(const ObjCorner &corner) {
+    uint64_t h = (corner.idx[0] + 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+    h ^= (corner.idx[1] + 0x632BE59BD9B4E019ull) * 0x94D049BB133111EBull;
+    h ^= (corner.idx[2] + 0xC2B2AE3D27D4EB4Full) * 0x165667B19E3779F9ull;
+    return h ^ (h >> 31);
+}
+
+inline bool sameCorner(const ObjCorner &a, const ObjCorner &b) {
+    return a.idx[0] == b.idx[0] && a.idx[1] == b.idx[1] && a.idx[2] == b.idx[2];
+}
+
+// Deduplicates the corners [first, last) into an indexed mesh. Corners are sharded by hash so every
+// shard owns a private open-addressing table and shards can be processed without synchronisation.
+bool buildMesh(const std::vector<ObjCorner> &corners, size_t first, size_t last, const std::vector<glm::vec3> &positions,
+               const std::vector<glm::vec2> &texCoords, const std::vector<glm::vec3> &normals, unsigned int threads, ObjMesh &mesh) {
+    JobSystem &jobs = JobSystem::Instance();
+    size_t count = last - first;
+    unsigned int shards = count < 65536 ? 1 : threads;
+
+    std::vector<size_t> shardCounts(shards * shards, 0);
+    jobs.ParallelSlices(shards, count, [&](size_t begin, size_t end, unsigned int t){
+        for(auto i = begin; i < end; i++)
+            shardCounts[t * shards + (hashCorner(corners[first + i]) >> 32) % shards]++;
+    });
+
+    std::vector<size_t> shardStart(shards + 1, 0);
+    std::vector<size_t> scatterOffset(shards * shards);
+    size_t running = 0;
+    for(auto s = 0U; s < shards; s++) {
+        shardStart[s] = running;
+        for(auto t = 0U; t < shards; t++) {
+            scatterOffset[t * shards + s] = running;
+            running += shardCounts[t * shards + s];
+        }
+    }
+    shardStart[shards] = running;
+
+    std::vector<uint32_t> order(count);
+    jobs.ParallelSlices(shards, count, [&](size_t begin, size_t end, unsigned int t){
+        for(auto i = begin; i < end; i++)
+            order[scatterOffset[t * shards + (hashCorner(corners[first + i]) >> 32) % shards]++] = static_cast<uint32_t>(i);
+    });
+
+    std::vector<uint32_t> localIds(count);
+    std::vector<std::vector<ObjCorner>> uniques(shards);
+    jobs.ParallelSlices(shards, shards, [&](size_t begin, size_t end, unsigned int){
+        for(auto s = begin; s < end; s++) {
+            size_t shardSize = shardStart[s + 1] - shardStart[s];
+            size_t capacity = 16;
+            while(capacity < shardSize * 2)
+                capacity <<= 1;
+            std::vector<uint32_t> table(capacity, MISSING);
+            auto &unique = uniques[s];
+            for(auto k = shardStart[s]; k < shardStart[s + 1]; k++) {
+                const ObjCorner &corner = corners[first + order[k]];
+                size_t slot = hashCorner(corner) & (capacity - 1);
+                while(table[slot] != MISSING && !sameCorner(unique[table[slot]], corner))
+                    slot = (slot + 1) & (capacity - 1);
+                if(table[slot] == MISSING) {
+                    table[slot] = static_cast<uint32_t>(unique.size());
+                    unique.push_back(corner);
+                }
+                localIds[order[k]] = table[slot];
+            }
+        }
+    });
+
+    std::vector<uint32_t> vertexBase(shards + 1, 0);
+    for(auto s = 0U; s < shards; s++)
+        vertexBase[s + 1] = vertexBase[s] + static_cast<uint32_t>(uniques[s].size());
+
+    std::atomic<bool> valid{true};
+    mesh.vertices.resize(vertexBase[shards]);
+    jobs.ParallelSlices(shards, shards, [&](size_t begin, size_t end, unsigned int){
+        for(auto s = begin; s < end; s++) {
+            for(auto j = 0U; j < uniques[s].size(); j++) {
+                const ObjCorner &corner = uniques[s][j];
+                Vertex &vertex = mesh.vertices[vertexBase[s] + j];
+                if(corner.idx[0] < positions.size()) {
+                    vertex.Position = positions[corner.idx[0]];
+                } else {
+                    vertex.Position = glm::vec3(0.0f);
+                    valid = false;
+                }
+                if(corner.idx[1] < texCoords.size())
+                    vertex.TexCoords = glm::vec2(texCoords[corner.idx[1]].x, 1.0f - texCoords[corner.idx[1]].y);
+                else
+                    vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                if(corner.idx[2] < normals.size())
+                    vertex.Normal = normals[corner.idx[2]];
+                else
+                    vertex.Normal = glm::vec3(0.0f);
+            }
+        }
+    });
+
+    mesh.indices.resize(count);
+    jobs.ParallelSlices(shards, count, [&](size_t begin, size_t end, unsigned int){
+        for(auto i = begin; i < end; i++)
+            mesh.indices[i] = vertexBase[(hashCorner(corners[first + i]) >> 32) % shards] + localIds[i];
+    });
+
+    return valid;
+}
+
+}
+
+bool LoadObj(const std::string &path, ObjScene &scene, unsigned int threads) {
+    JobSystem &jobs = JobSystem::Instance();
+    if(threads == 0)
+        threads = jobs.ThreadCount();
+
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if(!file) {
+        std::cerr << "failed to open obj file: " << path << std::endl;
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    std::vector<char> data(size > 0 ? size : 0);
+    size_t read = std::fread(data.data(), 1, data.size(), file);
+    std::fclose(file);
+    if(read != data.size()) {
+        std::cerr << "failed to read obj file: " << path << std::endl;
+        return false;
+    }
+
+    // split on line boundaries; tiny files are not worth the jobs
+    unsigned int chunkCount = data.size() < (1 << 20) ? 1 : threads;
+    std::vector<size_t> bounds(chunkCount + 1, data.size());
+    bounds[0] = 0;
+    for(auto c = 1U; c < chunkCount; c++) {
+        size_t pos = std::max(bounds[c - 1], data.size() * c / chunkCount);
+        while(pos < data.size() && data[pos - 1] != '\n')
+            pos++;
+        bounds[c] = pos;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    jobs.ParallelSlices(chunkCount, chunkCount, [&](size_t begin, size_t end, unsigned int){
+        for(auto c = begin; c < end; c++)
+            parseChunk(data.data() + bounds[c], data.data() + bounds[c + 1], chunks[c]);
+    });
+    data = std::vector<char>();
+
+    // merge the chunks into global arrays, patching relative indices with the chunk base offsets
+    std::vector<size_t> base(4 * (chunkCount + 1), 0);
+    for(auto c = 0U; c < chunkCount; c++) {
+        base[4 * (c + 1) + 0] = base[4 * c + 0] + chunks[c].positions.size();
+        base[4 * (c + 1) + 1] = base[4 * c + 1] + chunks[c].texCoords.size();
+        base[4 * (c + 1) + 2] = base[4 * c + 2] + chunks[c].normals.size();
+        base[4 * (c + 1) + 3] = base[4 * c + 3] + chunks[c].corners.size();
+    }
+
+    std::vector<glm::vec3> positions(base[4 * chunkCount + 0]);
+    std::vector<glm::vec2> texCoords(base[4 * chunkCount + 1]);
+    std::vector<glm::vec3> normals(base[4 * chunkCount + 2]);
+    std::vector<ObjCorner> corners(base[4 * chunkCount + 3]);
+    jobs.ParallelSlices(chunkCount, chunkCount, [&](size_t begin, size_t end, unsigned int){
+        for(auto c = begin; c < end; c++) {
+            ObjChunk &chunk = chunks[c];
+            for(auto slot : chunk.fixups) {
+                uint32_t &index = chunk.corners[slot / 3].idx[slot % 3];
+                index = static_cast<uint32_t>(static_cast<int64_t>(base[4 * c + slot % 3]) + static_cast<int32_t>(index));
+            }
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + base[4 * c + 0]);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + base[4 * c + 1]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + base[4 * c + 2]);
+            std::copy(chunk.corners.begin(), chunk.corners.end(), corners.begin() + base[4 * c + 3]);
+        }
+    });
+
+    auto slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::unordered_map<std::string, int> materialIndex;
+    scene.meshes.clear();
+    scene.materials.clear();
+    std::vector<ObjGroup> groups = {{0, ""}};
+    for(auto c = 0U; c < chunkCount; c++) {
+        for(auto &mtllib : chunks[c].mtllibs)
+            loadMtl(directory + '/' + mtllib, scene, materialIndex);
+        for(auto &group : chunks[c].groups)
+            groups.push_back({base[4 * c + 3] + group.firstCorner, group.material});
+    }
+    chunks = std::vector<ObjChunk>();
+
+    bool valid = true;
+    for(auto g = 0U; g < groups.size(); g++) {
+        size_t first = groups[g].firstCorner;
+        size_t last = g + 1 < groups.size() ? groups[g + 1].firstCorner : corners.size();
+        if(first == last)
+            continue;
+
+        ObjMesh mesh;
+        auto material = materialIndex.find(groups[g].material);
+        mesh.material = material != materialIndex.end() ? material->second : -1;
+        valid &= buildMesh(corners, first, last, positions, texCoords, normals, threads, mesh);
+        scene.meshes.push_back(std::move(mesh));
+    }
+
+    if(!valid)
+        std::cerr << "obj file references out of range vertices: " << path << std::endl;
+    return valid;
+}
@@ -0,0 +1,218 @@
+#include "particles.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace particleData = shader_reflection::particles;
+namespace kickoffCs = shader_reflection::particleKickoff;
+namespace emitCs = shader_reflection::particleEmit;
+namespace simulateCs = shader_reflection::particleSimulate;
+namespace particleVs = shader_reflection::particleVertex;
+
+namespace {
+
+// std430 layouts of Particle, ParticleEmitter and the ParticleCounters block in shaders/particles.glsl
+struct GpuParticle {
+    glm::vec3 position;
+    float size;
+    glm::vec3 velocity;
+    float age;
+    glm::vec3 color;
+    float lifetime;
+};
+
+struct GpuEmitter {
+    glm::vec4 shape;
+    glm::vec4 color;
+    glm::vec4 lifeSize;
+    glm::uvec4 emission;
+};
+
+struct GpuCounters {
+    uint32_t drawVertexCount, drawInstanceCount, drawFirst, drawBaseInstance;
+    uint32_t emitGroups[3];
+    uint32_t simulateGroups[3];
+    uint32_t deadCount;
+    uint32_t aliveCount;
+    uint32_t emitCount;
+};
+
+static_assert(sizeof(GpuParticle) == 48, "GpuParticle must match the std430 layout of Particle");
+static_assert(sizeof(GpuEmitter) == 64, "GpuEmitter must match the std430 layout of ParticleEmitter");
+
+}
+
+ParticleSystem::ParticleSystem(unsigned int capacity, ParticleParams params) : capacity(capacity), params(params) {
+}
+
+void ParticleSystem::SetCapacity(unsigned int capacity) {
+    release();
+    this->capacity = capacity;
+}
+
+void ParticleSystem::create() {
+    if(!emptyVAO) {
+        glGenVertexArrays(1, &emptyVAO);
+        glGenQueries(FRAMES_IN_FLIGHT, queries);
+    }
+
+    glGenBuffers(1, &particleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GpuParticle), nullptr, GL_DYNAMIC_COPY);
+    // every slot starts on the dead list; the two alive lists after it start empty
+    std::vector<uint32_t> dead(capacity);
+    for(auto i = 0U; i < capacity; i++)
+        dead[i] = i;
+    glGenBuffers(1, &listBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, listBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * size_t(capacity) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, dead.size() * sizeof(uint32_t), dead.data());
+    GpuCounters counters = {4, 0, 0, 0, {0, 1, 1}, {0, 1, 1}, capacity, 0, 0};
+    glGenBuffers(1, &counterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(counters), &counters, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &emitterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_EMITTERS * sizeof(GpuEmitter), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &readbackBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, FRAMES_IN_FLIGHT * sizeof(GpuCounters), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    list = 0;
+}
+
+void ParticleSystem::release() {
+    glDeleteBuffers(1, &particleBuffer);
+    glDeleteBuffers(1, &counterBuffer);
+    glDeleteBuffers(1, &emitterBuffer);
+    glDeleteBuffers(1, &listBuffer);
+    glDeleteBuffers(1, &readbackBuffer);
+    particleBuffer = counterBuffer = emitterBuffer = listBuffer = readbackBuffer = 0;
+    // results in flight refer to the old buffers
+    std::fill(std::begin(queryPending), std::end(queryPending), false);
+    alive = emitted = 0;
+}
+
+void ParticleSystem::resolve(unsigned int slot) {
+    if(!queryPending[slot])
+        return;
+    queryPending[slot] = false;
+    GLint available = 0;
+    glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+        return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+    gpuMs = elapsed / 1e6;
+    // the counter copy was issued before the query ended, so it has landed too
+    GpuCounters counters;
+    glBindBuffer(GL_COPY_READ_BUFFER, readbackBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, slot * sizeof(GpuCounters), sizeof(GpuCounters), &counters);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    alive = counters.drawInstanceCount;
+    emitted = counters.emitCount;
+}
+
+void ParticleSystem::Simulate(Shader &kickoff, Shader &emit, Shader &simulate, float deltaTime) {
+    if(!kickoff.Poll() || !emit.Poll() || !simulate.Poll() || capacity == 0)
+        return;
+    if(!particleBuffer)
+        create();
+    unsigned int slot = frame % FRAMES_IN_FLIGHT;
+    resolve(slot);
+
+    // each emitter's share of this frame's emission, as consecutive ranges of emit invocations
+    GpuEmitter gpuEmitters[MAX_EMITTERS];
+    auto emitterCount = static_cast<unsigned int>(std::min<size_t>(emitters.size(), MAX_EMITTERS));
+    emitCarry.resize(emitterCount, 0.0f);
+    uint32_t request = 0;
+    for(auto i = 0U; i < emitterCount; i++) {
+        const ParticleEmitter &emitter = emitters[i];
+        emitCarry[i] += std::max(emitter.rate, 0.0f) * deltaTime;
+        auto count = static_cast<uint32_t>(std::min(std::floor(emitCarry[i]), float(capacity)));
+        emitCarry[i] -= count;
+        gpuEmitters[i] = {glm::vec4(emitter.innerRadius, emitter.outerRadius, emitter.thickness, emitter.speedJitter), emitter.color,
+                          glm::vec4(emitter.minLife, emitter.maxLife, emitter.minSize, emitter.maxSize), glm::uvec4(request, count, 0u, 0u)};
+        request = std::min(request + count, capacity);
+    }
+    if(emitterCount > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, emitterBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, emitterCount * sizeof(GpuEmitter), gpuEmitters);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticlesBinding, particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticleCountersBinding, counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticleEmittersBinding, emitterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticleListsBinding, listBuffer);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, counterBuffer);
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+
+    kickoff.Use();
+    kickoff.SetUInt(kickoffCs::uniform::emitRequest, request);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    emit.Use();
+    emit.SetUInt(particleData::uniform::particleCapacity, capacity);
+    emit.SetUInt(particleData::uniform::particleList, list);
+    emit.SetUInt(emitCs::uniform::emitterCount, emitterCount);
+    emit.SetUInt(emitCs::uniform::particleSeed, seed++);
+    emit.SetFloat(emitCs::uniform::planetGravity, params.gravity);
+    glDispatchComputeIndirect(offsetof(GpuCounters, emitGroups));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    simulate.Use();
+    simulate.SetUInt(particleData::uniform::particleCapacity, capacity);
+    simulate.SetUInt(particleData::uniform::particleList, list);
+    simulate.SetFloat(simulateCs::uniform::planetGravity, params.gravity);
+    simulate.SetFloat(simulateCs::uniform::particleDeltaTime, deltaTime);
+    simulate.SetFloat(simulateCs::uniform::planetRadius, params.planetRadius);
+    simulate.SetFloat(simulateCs::uniform::particleDrag, params.drag);
+    glDispatchComputeIndirect(offsetof(GpuCounters, simulateGroups));
+    // the renderer reads the new alive list and its count as draw parameters; the readback copies the counters
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, counterBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot * sizeof(GpuCounters), sizeof(GpuCounters));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glEndQuery(GL_TIME_ELAPSED);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    queryPending[slot] = true;
+    frame++;
+    list = 1 - list;
+}
+
+void ParticleSystem::Draw(Shader &render, const glm::mat4 &projection, const glm::mat4 &view) {
+    if(!particleBuffer || !render.Poll())
+        return;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    render.Use();
+    render.SetMat4(particleVs::uniform::projection, projection);
+    render.SetMat4(particleVs::uniform::view, view);
+    render.SetFloat(particleVs::uniform::particlePixelSize, 2.0f / (projection[1][1] * std::max(viewport[3], 1)));
+    render.SetUInt(particleData::uniform::particleCapacity, capacity);
+    render.SetUInt(particleData::uniform::particleList, list);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticlesBinding, particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, particleData::block::ParticleListsBinding, listBuffer);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(emptyVAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, counterBuffer);
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,244 @@
+#include "physics.h"
+
+#include <reactphysics3d/reactphysics3d.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include "profiler.h"
+
+namespace {
+
+// a step that starts this many steps late drops the backlog instead of trying to catch up
+const int MAX_LATE_STEPS = 5;
+
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+rp3d::Vector3 toRp3d(const glm::vec3 &v) {
+    return rp3d::Vector3(v.x, v.y, v.z);
+}
+
+glm::vec3 toGlm(const rp3d::Vector3 &v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+}
+
+// Collects how far the camera sphere penetrates the asteroids during one world update
+class AsteroidPhysics::ContactListener : public rp3d::EventListener {
+public:
+    rp3d::RigidBody *camera = nullptr;
+    glm::vec3 push = glm::vec3(0.0f);
+
+    void onContact(const rp3d::CollisionCallback::CallbackData &data) override {
+        for(rp3d::uint pair = 0; pair < data.getNbContactPairs(); pair++) {
+            rp3d::CollisionCallback::ContactPair contact = data.getContactPair(pair);
+            if(contact.getEventType() == rp3d::CollisionCallback::ContactPair::EventType::ContactExit)
+                continue;
+            // world normals point from body 1 to body 2
+            float side;
+            if(contact.getBody1() == camera)
+                side = -1.0f;
+            else if(contact.getBody2() == camera)
+                side = 1.0f;
+            else
+                continue;
+            glm::vec3 deepest(0.0f);
+            float depth = 0.0f;
+            for(rp3d::uint point = 0; point < contact.getNbContactPoints(); point++) {
+                rp3d::CollisionCallback::ContactPoint contactPoint = contact.getContactPoint(point);
+                if(contactPoint.getPenetrationDepth() > depth) {
+                    depth = contactPoint.getPenetrationDepth();
+                    deepest = toGlm(contactPoint.getWorldNormal()) * (side * depth);
+                }
+            }
+            push += deepest;
+        }
+    }
+};
+
+AsteroidPhysics::AsteroidPhysics(PhysicsParams params) : params(params), common(new rp3d::PhysicsCommon()) {
+}
+
+AsteroidPhysics::~AsteroidPhysics() {
+    Stop();
+    delete common;
+}
+
+void AsteroidPhysics::Start(const std::vector<glm::mat4> &transforms, const std::vector<float> &radii) {
+    Stop();
+
+    rp3d::PhysicsWorld::WorldSettings settings;
+    // the planet's pull depends on distance, so it is applied per body in applyGravity()
+    settings.gravity = rp3d::Vector3(0.0f, 0.0f, 0.0f);
+    world = common->createPhysicsWorld(settings);
+    listener = new ContactListener();
+    world->setEventListener(listener);
+
+    std::mt19937 random(static_cast<uint32_t>(transforms.size()));
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    auto randomVector = [&](float scale) { return glm::vec3(jitter(random), jitter(random), jitter(random)) * scale; };
+
+    for(auto i = 0U; i < transforms.size(); i++) {
+        const glm::mat4 &transform = transforms[i];
+        float scale = glm::length(glm::vec3(transform[0]));
+        glm::mat3 rotation(glm::vec3(transform[0]) / scale, glm::vec3(transform[1]) / scale, glm::vec3(transform[2]) / scale);
+        glm::quat orientation = glm::quat_cast(rotation);
+        glm::vec3 position(transform[3]);
+        scales.push_back(scale);
+
+        rp3d::RigidBody *body = world->createRigidBody(rp3d::Transform(toRp3d(position),
+                rp3d::Quaternion(orientation.x, orientation.y, orientation.z, orientation.w)));
+        rp3d::SphereShape *shape = common->createSphereShape(radii[i]);
+        shapes.push_back(shape);
+        body->addCollider(shape, rp3d::Transform::identity());
+        body->updateMassPropertiesFromColliders();
+
+        // circular orbit in the direction the ring would turn, plus a little scatter
+        float distance = glm::length(position);
+        glm::vec3 tangent = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), position));
+        glm::vec3 velocity = tangent * std::sqrt(params.planetGM / distance) + randomVector(params.velocityJitter);
+        body->setLinearVelocity(toRp3d(velocity));
+        body->setAngularVelocity(toRp3d(randomVector(params.spinJitter)));
+        bodies.push_back(body);
+    }
+
+    cameraBody = world->createRigidBody(rp3d::Transform::identity());
+    cameraBody->setType(rp3d::BodyType::KINEMATIC);
+    rp3d::SphereShape *cameraShape = common->createSphereShape(params.cameraRadius);
+    shapes.push_back(cameraShape);
+    cameraBody->addCollider(cameraShape, rp3d::Transform::identity());
+    listener->camera = cameraBody;
+
+    haveFrame = false;
+    consumedPush = glm::dvec3(0.0);
+    running = true;
+    thread = std::thread(&AsteroidPhysics::run, this);
+}
+
+void AsteroidPhysics::Stop() {
+    if(thread.joinable()) {
+        running = false;
+        thread.join();
+    }
+    // drop a frame the old bodies published but nobody read
+    frames.Update();
+    haveFrame = false;
+    if(world) {
+        // destroying the world destroys its bodies; shapes belong to PhysicsCommon
+        common->destroyPhysicsWorld(world);
+        world = nullptr;
+    }
+    for(auto *shape : shapes)
+        common->destroySphereShape(shape);
+    shapes.clear();
+    bodies.clear();
+    scales.clear();
+    cameraBody = nullptr;
+    delete listener;
+    listener = nullptr;
+}
+
+void AsteroidPhysics::SetCamera(const glm::vec3 &position) {
+    camera.Back() = position;
+    camera.Publish();
+}
+
+bool AsteroidPhysics::Interpolate(std::vector<glm::mat4> &out, glm::vec3 &cameraPush) {
+    bool fresh = frames.Update();
+    haveFrame = haveFrame || fresh;
+    cameraPush = glm::vec3(0.0f);
+    if(!haveFrame)
+        return false;
+
+    const Frame &frame = frames.Front();
+    if(fresh) {
+        cameraPush = glm::vec3(frame.cameraPushTotal - consumedPush);
+        consumedPush = frame.cameraPushTotal;
+    }
+    // the frame's `current` was produced at frame.time, so the render time falls between previous and current
+    float alpha = static_cast<float>(std::min(std::max((now() - frame.time) / params.timeStep, 0.0), 1.0));
+    out.resize(frame.current.size());
+    for(size_t i = 0; i < frame.current.size(); i++) {
+        glm::vec3 position = glm::mix(frame.previous[i].position, frame.current[i].position, alpha);
+        glm::quat orientation = glm::slerp(frame.previous[i].orientation, frame.current[i].orientation, alpha);
+        glm::mat4 transform = glm::mat4_cast(orientation);
+        transform[0] *= scales[i];
+        transform[1] *= scales[i];
+        transform[2] *= scales[i];
+        transform[3] = glm::vec4(position, 1.0f);
+        out[i] = transform;
+    }
+    return true;
+}
+
+void AsteroidPhysics::applyGravity() {
+    for(auto *body : bodies) {
+        glm::vec3 position = toGlm(body->getTransform().getPosition());
+        float distance = glm::length(position);
+        glm::vec3 force = position * (-params.planetGM * body->getMass() / (distance * distance * distance));
+        body->applyWorldForceAtCenterOfMass(toRp3d(force));
+    }
+}
+
+void AsteroidPhysics::run() {
+    auto readPoses = [&](std::vector<Pose> &poses) {
+        poses.resize(bodies.size());
+        for(size_t i = 0; i < bodies.size(); i++) {
+            const rp3d::Transform &transform = bodies[i]->getTransform();
+            const rp3d::Quaternion &q = transform.getOrientation();
+            poses[i] = Pose{toGlm(transform.getPosition()), glm::quat(q.w, q.x, q.y, q.z)};
+        }
+    };
+    std::vector<Pose> last;
+    readPoses(last);
+    glm::vec3 cameraPosition(0.0f);
+    bool haveCamera = false;
+    // frames the reader never sees are overwritten, so pushes are published as a running sum
+    glm::dvec3 pushTotal(0.0);
+
+    double step = params.timeStep;
+    double next = now();
+    while(running) {
+        next += step;
+        double late = now() - next;
+        if(late < 0.0)
+            std::this_thread::sleep_for(std::chrono::duration<double>(-late));
+        else if(late > step * MAX_LATE_STEPS)
+            next = now();
+        if(paused)
+            continue;
+
+        PROFILE_CPU_SCOPE("physics");
+        double start = now();
+        // the kinematic camera body is swept from its last position to the new one over the step, so the
+        // solver sees its velocity and bounces asteroids off it
+        if(camera.Update()) {
+            glm::vec3 target = camera.Front();
+            if(!haveCamera)
+                cameraPosition = target;
+            haveCamera = true;
+            cameraBody->setTransform(rp3d::Transform(toRp3d(cameraPosition), rp3d::Quaternion::identity()));
+            cameraBody->setLinearVelocity(toRp3d((target - cameraPosition) / params.timeStep));
+            cameraPosition = target;
+        } else {
+            cameraBody->setLinearVelocity(rp3d::Vector3(0.0f, 0.0f, 0.0f));
+        }
+
+        applyGravity();
+        listener->push = glm::vec3(0.0f);
+        world->update(params.timeStep);
+
+        Frame &frame = frames.Back();
+        frame.previous = last;
+        readPoses(frame.current);
+        last = frame.current;
+        pushTotal += glm::dvec3(listener->push);
+        frame.cameraPushTotal = pushTotal;
+        frame.time = now();
+        frames.Publish();
+        stepMs = (now() - start) * 1000.0;
+    }
+}
@@ -0,0 +1,123 @@
+#include "picking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const unsigned int BATCH = MeshRaycaster::BATCH;
+// rejects triangles nearly parallel to the ray and hits at the ray origin
+const float EPSILON = 1e-7f;
+
+}
+
+Ray ScreenRay(const glm::vec2 &cursor, const glm::vec2 &windowSize, const glm::mat4 &projection, const glm::mat4 &view) {
+    float x = 2.0f * cursor.x / windowSize.x - 1.0f;
+    float y = 1.0f - 2.0f * cursor.y / windowSize.y;
+    glm::mat4 inverse = glm::inverse(projection * view);
+    glm::vec4 near = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 far = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(near) / near.w;
+    return Ray{origin, glm::normalize(glm::vec3(far) / far.w - origin)};
+}
+
+MeshRaycaster::MeshRaycaster(const std::vector<Mesh> &meshes) {
+    for(auto &mesh : meshes) {
+        meshStart.push_back(triangles);
+        triangles += static_cast<uint32_t>(mesh.indices.size() / 3);
+    }
+    // padding lanes are degenerate triangles, which the determinant test rejects
+    size_t padded = (triangles + BATCH - 1) / BATCH * BATCH;
+    for(auto *array : {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z})
+        array->assign(padded, 0.0f);
+
+    uint32_t triangle = 0;
+    for(auto &mesh : meshes) {
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3, triangle++) {
+            glm::vec3 a = mesh.vertices[mesh.indices[i]].Position;
+            glm::vec3 b = mesh.vertices[mesh.indices[i + 1]].Position;
+            glm::vec3 c = mesh.vertices[mesh.indices[i + 2]].Position;
+            v0x[triangle] = a.x; v0y[triangle] = a.y; v0z[triangle] = a.z;
+            e1x[triangle] = b.x - a.x; e1y[triangle] = b.y - a.y; e1z[triangle] = b.z - a.z;
+            e2x[triangle] = c.x - a.x; e2y[triangle] = c.y - a.y; e2z[triangle] = c.z - a.z;
+        }
+    }
+}
+
+bool MeshRaycaster::Intersect(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, float &t, uint32_t &triangle) const {
+    const float MISS = std::numeric_limits<float>::infinity();
+    float best = maxDistance;
+    uint32_t bestTriangle = std::numeric_limits<uint32_t>::max();
+    float dx = direction.x, dy = direction.y, dz = direction.z;
+    for(size_t base = 0; base < v0x.size(); base += BATCH) {
+        float hits[BATCH];
+        for(auto lane = 0U; lane < BATCH; lane++) {
+            size_t i = base + lane;
+            // p = d x e2
+            float px = dy * e2z[i] - dz * e2y[i];
+            float py = dz * e2x[i] - dx * e2z[i];
+            float pz = dx * e2y[i] - dy * e2x[i];
+            float det = e1x[i] * px + e1y[i] * py + e1z[i] * pz;
+            float inverse = 1.0f / det;
+            float sx = origin.x - v0x[i], sy = origin.y - v0y[i], sz = origin.z - v0z[i];
+            float u = (sx * px + sy * py + sz * pz) * inverse;
+            // q = s x e1
+            float qx = sy * e1z[i] - sz * e1y[i];
+            float qy = sz * e1x[i] - sx * e1z[i];
+            float qz = sx * e1y[i] - sy * e1x[i];
+            float v = (dx * qx + dy * qy + dz * qz) * inverse;
+            float distance = (e2x[i] * qx + e2y[i] * qy + e2z[i] * qz) * inverse;
+            bool hit = std::fabs(det) > EPSILON && u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance > EPSILON;
+            hits[lane] = hit ? distance : MISS;
+        }
+        for(auto lane = 0U; lane < BATCH; lane++) {
+            if(hits[lane] < best) {
+                best = hits[lane];
+                bestTriangle = static_cast<uint32_t>(base + lane);
+            }
+        }
+    }
+    if(bestTriangle == std::numeric_limits<uint32_t>::max())
+        return false;
+    t = best;
+    triangle = bestTriangle;
+    return true;
+}
+
+void MeshRaycaster::Locate(uint32_t triangle, uint32_t &mesh, uint32_t &local) const {
+    auto start = std::upper_bound(meshStart.begin(), meshStart.end(), triangle) - 1;
+    mesh = static_cast<uint32_t>(start - meshStart.begin());
+    local = triangle - *start;
+}
+
+bool PickInstance(const Ray &ray, const BVH &instances, const MeshRaycaster &mesh,
+                  const std::function<glm::mat4(uint32_t)> &instanceTransform, PickHit &hit, float maxDistance) {
+    std::vector<RayHit> candidates;
+    instances.QueryRay(ray.origin, ray.direction, maxDistance, candidates);
+    std::sort(candidates.begin(), candidates.end(), [](const RayHit &a, const RayHit &b) { return a.distance < b.distance; });
+
+    float best = maxDistance;
+    bool found = false;
+    for(auto &candidate : candidates) {
+        if(candidate.distance > best)
+            break;
+        // the direction is taken to instance space unnormalized, so t along it is still a world distance
+        glm::mat4 toInstance = glm::inverse(instanceTransform(candidate.instance));
+        glm::vec3 origin(toInstance * glm::vec4(ray.origin, 1.0f));
+        glm::vec3 direction(toInstance * glm::vec4(ray.direction, 0.0f));
+        float t;
+        uint32_t triangle;
+        if(!mesh.Intersect(origin, direction, best, t, triangle))
+            continue;
+        best = t;
+        found = true;
+        hit.instance = candidate.instance;
+        mesh.Locate(triangle, hit.mesh, hit.triangle);
+    }
+    if(!found)
+        return false;
+    hit.distance = best;
+    hit.position = ray.origin + ray.direction * best;
+    return true;
+}
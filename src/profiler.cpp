@@ -0,0 +1,244 @@
+#include "profiler.h"
+
+#include <glad/glad.h>
+#include <imgui.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+std::atomic<uint32_t> threadCount{0};
+thread_local const uint32_t threadIndex = threadCount++;
+thread_local uint32_t threadDepth = 0;
+
+}
+
+Profiler &Profiler::Instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() = default;
+
+double Profiler::Now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::BeginFrame() {
+    frameIndex++;
+    QuerySet &set = sets[frameIndex % FRAMES_IN_FLIGHT];
+    resolve(set);
+
+    if(set.queries.size() < 2) {
+        set.queries.resize(2);
+        glGenQueries(2, set.queries.data());
+    }
+    set.used = 2;
+    glQueryCounter(set.queries[0], GL_TIMESTAMP);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    set.frame = ProfileFrame();
+    set.frame.index = frameIndex;
+    set.frame.cpuStart = Now();
+    current = &set;
+}
+
+void Profiler::EndFrame() {
+    if(!current)
+        return;
+    glQueryCounter(current->queries[1], GL_TIMESTAMP);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    current->frame.cpuEnd = Now();
+    current->inFlight = true;
+    current = nullptr;
+}
+
+int Profiler::BeginGpuQuery() {
+    if(!current)
+        return -1;
+    QuerySet &set = *current;
+    if(set.used + 2 > set.queries.size()) {
+        auto size = set.queries.size();
+        set.queries.resize(size * 2);
+        glGenQueries(static_cast<GLsizei>(size), set.queries.data() + size);
+    }
+    int query = static_cast<int>(set.used);
+    set.used += 2;
+    glQueryCounter(set.queries[query], GL_TIMESTAMP);
+    return query;
+}
+
+void Profiler::EndGpuQuery(int query) {
+    if(current && query >= 0)
+        glQueryCounter(current->queries[query + 1], GL_TIMESTAMP);
+}
+
+void Profiler::Record(const ProfileZone &zone) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(current)
+        current->frame.zones.push_back(zone);
+}
+
+void Profiler::resolve(QuerySet &set) {
+    if(!set.inFlight)
+        return;
+    set.inFlight = false;
+
+    // the frame end timestamp is issued last, so once it is available every query of the set is
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(set.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available) {
+        std::vector<GLuint64> times(set.used);
+        for(auto i = 0U; i < set.used; i++)
+            glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &times[i]);
+        set.frame.gpuMs = (times[1] - times[0]) / 1e6;
+        for(auto &zone : set.frame.zones) {
+            if(zone.query < 0)
+                continue;
+            zone.gpuStart = (static_cast<int64_t>(times[zone.query] - times[0])) / 1e6;
+            zone.gpuEnd = (static_cast<int64_t>(times[zone.query + 1] - times[0])) / 1e6;
+        }
+    }
+
+    addHistory(set.frame);
+    if(captureRemaining > 0) {
+        captured.push_back(set.frame);
+        if(--captureRemaining == 0) {
+            writeTrace();
+            captured.clear();
+        }
+    }
+}
+
+void Profiler::addHistory(const ProfileFrame &frame) {
+    historyOffset = (historyOffset + 1) % HISTORY;
+    lastCpuMs = frame.cpuEnd - frame.cpuStart;
+    lastGpuMs = std::max(frame.gpuMs, 0.0);
+    cpuHistory[historyOffset] = static_cast<float>(lastCpuMs);
+    gpuHistory[historyOffset] = static_cast<float>(lastGpuMs);
+
+    for(auto &zone : zones) {
+        zone.second.cpu[historyOffset] = 0.0f;
+        zone.second.gpu[historyOffset] = 0.0f;
+    }
+    // a zone entered several times in one frame reports the sum
+    for(auto &zone : frame.zones) {
+        ZoneHistory &history = zones[zone.name];
+        history.cpu[historyOffset] += static_cast<float>(zone.cpuEnd - zone.cpuStart);
+        if(zone.gpuStart >= 0.0) {
+            history.gpu[historyOffset] += static_cast<float>(zone.gpuEnd - zone.gpuStart);
+            history.hasGpu = true;
+        }
+    }
+}
+
+void Profiler::CaptureTrace(const std::string &path, unsigned int frames) {
+    capturePath = path;
+    captureRemaining = frames;
+    captured.clear();
+    captured.reserve(frames);
+}
+
+void Profiler::writeTrace() const {
+    std::ofstream file(capturePath, std::ios::trunc);
+    if(!file) {
+        std::cerr << "failed to write profiler trace: " << capturePath << std::endl;
+        return;
+    }
+
+    // CPU threads go under pid 1 with tid = thread index, the GPU timeline is pid 2. GPU timestamps have no
+    // common epoch with steady_clock, so each frame's GPU track is aligned to the CPU start of that frame.
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+    auto event = [&](const char *name, int pid, uint32_t tid, double startMs, double endMs) {
+        file << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+             << ",\"ts\":" << startMs * 1000.0 << ",\"dur\":" << (endMs - startMs) * 1000.0 << "}";
+    };
+    file.precision(3);
+    file << std::fixed;
+    for(auto &frame : captured) {
+        std::string name = "frame " + std::to_string(frame.index);
+        event(name.c_str(), 1, 0, frame.cpuStart, frame.cpuEnd);
+        if(frame.gpuMs >= 0.0)
+            event(name.c_str(), 2, 0, frame.cpuStart, frame.cpuStart + frame.gpuMs);
+        for(auto &zone : frame.zones) {
+            event(zone.name, 1, zone.thread, zone.cpuStart, zone.cpuEnd);
+            if(zone.gpuStart >= 0.0)
+                event(zone.name, 2, 0, frame.cpuStart + zone.gpuStart, frame.cpuStart + zone.gpuEnd);
+        }
+    }
+    file << "\n]}\n";
+    std::cout << "wrote " << captured.size() << " frames to " << capturePath << std::endl;
+}
+
+void Profiler::DrawImGui() {
+    ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("CPU %.2f ms   GPU %.2f ms", lastCpuMs, lastGpuMs);
+    int offset = static_cast<int>((historyOffset + 1) % HISTORY);
+    ImGui::PlotLines("CPU ms", cpuHistory, HISTORY, offset, nullptr, 0.0f, 33.3f, ImVec2(320, 60));
+    ImGui::PlotLines("GPU ms", gpuHistory, HISTORY, offset, nullptr, 0.0f, 33.3f, ImVec2(320, 60));
+
+    if(ImGui::BeginTable("zones", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("CPU avg");
+        ImGui::TableSetupColumn("CPU max");
+        ImGui::TableSetupColumn("GPU avg");
+        ImGui::TableSetupColumn("GPU max");
+        ImGui::TableHeadersRow();
+        for(auto &zone : zones) {
+            float cpuSum = 0.0f, cpuMax = 0.0f, gpuSum = 0.0f, gpuMax = 0.0f;
+            for(auto i = 0U; i < HISTORY; i++) {
+                cpuSum += zone.second.cpu[i];
+                cpuMax = std::max(cpuMax, zone.second.cpu[i]);
+                gpuSum += zone.second.gpu[i];
+                gpuMax = std::max(gpuMax, zone.second.gpu[i]);
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(zone.first.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", cpuSum / HISTORY);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", cpuMax);
+            ImGui::TableNextColumn();
+            if(zone.second.hasGpu)
+                ImGui::Text("%.3f", gpuSum / HISTORY);
+            ImGui::TableNextColumn();
+            if(zone.second.hasGpu)
+                ImGui::Text("%.3f", gpuMax);
+        }
+        ImGui::EndTable();
+    }
+
+    static int traceFrames = 120;
+    ImGui::InputInt("Frames", &traceFrames);
+    traceFrames = std::max(traceFrames, 1);
+    if(Capturing())
+        ImGui::Text("Capturing, %u frames left", captureRemaining);
+    else if(ImGui::Button("Capture trace"))
+        CaptureTrace("profile.json", static_cast<unsigned int>(traceFrames));
+    ImGui::End();
+}
+
+ProfileScope::ProfileScope(const char *name, bool gpu) {
+    Profiler &profiler = Profiler::Instance();
+    zone.name = name;
+    zone.thread = threadIndex;
+    zone.depth = threadDepth++;
+    zone.query = gpu ? profiler.BeginGpuQuery() : -1;
+    zone.cpuStart = profiler.Now();
+}
+
+ProfileScope::~ProfileScope() {
+    Profiler &profiler = Profiler::Instance();
+    zone.cpuEnd = profiler.Now();
+    profiler.EndGpuQuery(zone.query);
+    threadDepth--;
+    profiler.Record(zone);
+}
@@ -0,0 +1,161 @@
+#include "programcache.h"
+
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x42505247; // "GRPB"
+// far above any real program binary; a larger length means the entry is not one of ours
+const uint64_t MAX_BINARY_LENGTH = 64ull * 1024 * 1024;
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for(auto i = 0U; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// the per-user cache directory (XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%), else next to the executable, so
+// entries neither depend on nor litter the working directory the binary was started from
+std::string defaultDirectory() {
+    if(auto xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/OpenGL/shader_cache";
+    if(auto home = std::getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/OpenGL/shader_cache";
+    if(auto local = std::getenv("LOCALAPPDATA"); local && *local)
+        return std::string(local) + "/OpenGL/shader_cache";
+    std::error_code error;
+    auto executable = std::filesystem::read_symlink("/proc/self/exe", error);
+    if(!error)
+        return (executable.parent_path() / "shader_cache").string();
+    return "shader_cache";
+}
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint64_t length;
+};
+
+}
+
+ProgramCache::ProgramCache() : directory(defaultDirectory()) {}
+
+ProgramCache &ProgramCache::Instance() {
+    static ProgramCache cache;
+    return cache;
+}
+
+bool ProgramCache::Enabled() {
+    if(supported < 0) {
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0;
+        if(!supported)
+            std::cout << "shader cache: driver exposes no program binary formats, caching disabled" << std::endl;
+    }
+    return supported > 0;
+}
+
+uint64_t ProgramCache::Key(const std::vector<std::string> &sources) {
+    if(driver.empty()) {
+        for(auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            auto value = reinterpret_cast<const char *>(glGetString(name));
+            driver += value ? value : "";
+            driver += '\n';
+        }
+    }
+
+    uint64_t hash = fnv1a(0xcbf29ce484222325ull, driver.data(), driver.size());
+    for(auto &source : sources) {
+        uint64_t length = source.size();
+        hash = fnv1a(hash, &length, sizeof(length));
+        hash = fnv1a(hash, source.data(), source.size());
+    }
+    return hash;
+}
+
+std::string ProgramCache::entryPath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+bool ProgramCache::Load(uint64_t key, unsigned int program) {
+    if(!Enabled())
+        return false;
+
+    std::string path = entryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    CacheHeader header{};
+    if(!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key) {
+        misses++;
+        std::cout << "shader cache miss: " << path << std::endl;
+        return false;
+    }
+
+    // the length comes from disk, so it is checked against what the file holds before allocating for it
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(path, error);
+    if(error || header.length == 0 || header.length > MAX_BINARY_LENGTH || header.length != fileSize - sizeof(header)) {
+        misses++;
+        std::cout << "shader cache miss (truncated entry): " << path << std::endl;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), binary.size());
+    if(!file) {
+        misses++;
+        std::cout << "shader cache miss (truncated entry): " << path << std::endl;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success) {
+        misses++;
+        std::cout << "shader cache miss (binary rejected by driver, invalidating): " << path << std::endl;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    hits++;
+    std::cout << "shader cache hit: " << path << std::endl;
+    return true;
+}
+
+void ProgramCache::Store(uint64_t key, unsigned int program) {
+    if(!Enabled())
+        return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = entryPath(key);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    CacheHeader header{CACHE_MAGIC, format, key, static_cast<uint64_t>(length)};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+    if(!file)
+        std::cerr << "failed to write shader cache entry: " << path << std::endl;
+}
@@ -1,185 +1,460 @@
 #include "shader.h"
+#include "programcache.h"
+#include "shaderpreprocessor.h"
+#include "shader_reflection.h"
+#ifdef SHADER_SPIRV
+#include "shaders_spirv.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
 #include "glm/gtc/type_ptr.hpp"
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        vShaderFile.close();
-        fShaderFile.close();
-        vertexCode   = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch(std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
-        return;
+namespace {
+
+std::string fileName(const std::string &path) {
+    auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+const char *stageName(GLenum type) {
+    switch(type) {
+        case GL_VERTEX_SHADER:   return "vertex";
+        case GL_GEOMETRY_SHADER: return "geometry";
+        case GL_FRAGMENT_SHADER: return "fragment";
+        case GL_COMPUTE_SHADER:  return "compute";
+        default:                 return "unknown";
     }
+}
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+#ifdef SHADER_SPIRV
+// defines that SPIR-V builds take as specialization constants (layout(constant_id = N)) instead of separate binaries
+const std::pair<const char *, GLuint> specializationConstants[] = {{"ALPHA_TEST", 0}};
 
-    unsigned int vxShader, fgShader;
-    vxShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vxShader, 1, &vShaderCode, NULL);
-    glCompileShader(vxShader);
+const char *spirvStage(GLenum type) {
+    switch(type) {
+        case GL_VERTEX_SHADER:   return "vert";
+        case GL_GEOMETRY_SHADER: return "geom";
+        case GL_FRAGMENT_SHADER: return "frag";
+        case GL_COMPUTE_SHADER:  return "comp";
+        default:                 return "";
+    }
+}
 
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vxShader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        glGetShaderInfoLog(vxShader, 512, NULL, infoLog);
-        std::cerr << "failed to compile vertex shader:\n " << infoLog << std::endl;
+// points stage at the embedded SPIR-V build of file compiled with the applied defines, if there is one.
+// Only the initial load comes here, so the build-time binaries are used even when sources are read from
+// the source tree; programs the watcher rebuilds from edited files take the GLSL path.
+void attachSpirv(ShaderStage &stage, const std::string &file, std::vector<std::string> applied) {
+    if(!GLAD_GL_ARB_gl_spirv)
+        return;
+
+    std::sort(applied.begin(), applied.end());
+    std::string defines;
+    std::vector<GLuint> indices, values;
+    for(auto &define : applied) {
+        auto equals = define.find('=');
+        std::string name = define.substr(0, equals);
+        auto constant = std::find_if(std::begin(specializationConstants), std::end(specializationConstants),
+                                     [&](const std::pair<const char *, GLuint> &c){ return name == c.first; });
+        if(constant != std::end(specializationConstants)) {
+            indices.push_back(constant->second);
+            values.push_back(equals == std::string::npos ? 1 : std::stoul(define.substr(equals + 1)));
+            continue;
+        }
+        defines += (defines.empty() ? "" : ",") + define;
     }
 
-    fgShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fgShader, 1, &fShaderCode, NULL);
-    glCompileShader(fgShader);
-    glGetShaderiv(fgShader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        glGetShaderInfoLog(fgShader, 512, NULL, infoLog);
-        std::cerr << "failed to compile fragment shader:\n" << infoLog << std::endl;
+    for(auto &spirv : spirv_shaders::files) {
+        if(file == spirv.name && std::strcmp(spirv.stage, spirvStage(stage.type)) == 0 && defines == spirv.defines) {
+            stage.binary = spirv.binary;
+            stage.binarySize = spirv.size;
+            stage.specIndices = std::move(indices);
+            stage.specValues = std::move(values);
+            return;
+        }
     }
+    // spirvVariants in CMakeLists.txt has to list every variant the program asks for
+    std::cerr << "no embedded SPIR-V for " << file << " (" << spirvStage(stage.type) << ", defines \"" << defines
+              << "\"), compiling GLSL" << std::endl;
+}
+#endif
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vxShader);
-    glAttachShader(ID, fgShader);
-    glLinkProgram(ID);
+}
 
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if(!success) {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
-        std::cerr << "failed to compile shader program:\n " << infoLog << std::endl;
+Shader::Shader(const char *vertexPath, const char *fragmentPath) : Shader(ShaderProgramDesc{vertexPath, "", fragmentPath, {}}) {
+}
+
+Shader::Shader(const char* vertexPath, const char *geometryPath, const char* fragmentPath)
+    : Shader(ShaderProgramDesc{vertexPath, geometryPath, fragmentPath, {}}) {
+}
+
+Shader::Shader(ShaderProgramDesc desc) : desc(std::move(desc)) {
+    load("");
+}
+
+Shader::Shader(ShaderProgramDesc desc, const std::vector<ShaderStage> &stages, std::vector<std::string> dependencies)
+    : desc(std::move(desc)), dependencies(std::move(dependencies)), sourceHash(HashSources(stages)) {
+    // stages that failed to preprocess leave the placeholder bound until a reload succeeds
+    if(!stages.empty())
+        build(stages);
+}
+
+Shader::Shader(ShaderProgramDesc desc, Shader &program, std::vector<std::string> dependencies)
+    : desc(std::move(desc)), dependencies(std::move(dependencies)), shared(&program), sourceHash(program.sourceHash) {
+}
+
+uint64_t Shader::HashSources(const std::vector<ShaderStage> &stages) {
+    std::vector<std::string> sources;
+    for(auto &stage : stages)
+        sources.push_back(std::to_string(stage.type) + '\n' + stage.source);
+    return ProgramCache::Instance().Key(sources);
+}
+
+bool ShaderProgramDesc::Preprocess(const std::string &directory, std::vector<ShaderStage> &stages, std::vector<std::string> &dependencies) const {
+    std::pair<GLenum, const std::string *> files[] = {{GL_VERTEX_SHADER, &vertex}, {GL_GEOMETRY_SHADER, &geometry}, {GL_FRAGMENT_SHADER, &fragment},
+                                                      {GL_COMPUTE_SHADER, &compute}};
+    stages.clear();
+    dependencies.clear();
+    for(auto &file : files) {
+        if(file.second->empty())
+            continue;
+        std::string path = directory.empty() ? *file.second : directory + '/' + fileName(*file.second);
+        ShaderStage stage{file.first, ""};
+        std::vector<std::string> stageDependencies, applied;
+        if(!PreprocessShader(path, defines, stage.source, stageDependencies, &applied)) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            // keep every stage file a dependency so fixing any of them brings the program back through a reload
+            dependencies.insert(dependencies.end(), stageDependencies.begin(), stageDependencies.end());
+            for(auto &other : files)
+                if(!other.second->empty() && std::find(dependencies.begin(), dependencies.end(), *other.second) == dependencies.end())
+                    dependencies.push_back(*other.second);
+            stages.clear();
+            return false;
+        }
+#ifdef SHADER_SPIRV
+        // reloads from disk always go through the GLSL path so edits show up without a rebuild
+        if(directory.empty())
+            attachSpirv(stage, fileName(*file.second), applied);
+#endif
+        stages.push_back(std::move(stage));
+        dependencies.insert(dependencies.end(), stageDependencies.begin(), stageDependencies.end());
     }
+    return true;
+}
 
-    glDeleteShader(vxShader);
-    glDeleteShader(fgShader);
+void Shader::EnableParallelCompile() {
+    if(GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if(GLAD_GL_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+}
+
+bool Shader::load(const std::string &directory) {
+    std::vector<ShaderStage> stages;
+    if(!desc.Preprocess(directory, stages, dependencies))
+        return false;
+
+    sourceHash = HashSources(stages);
+    // the program this variant shares was reloaded first, so an unchanged hash means it is still current
+    if(shared && !ID && sourceHash == shared->sourceHash)
+        return true;
+    build(stages);
+    return true;
 }
 
-Shader::Shader(const char* vertexPath, const char *geometryPath, const char* fragmentPath) {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    std::ifstream gShaderFile;
-    vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        gShaderFile.open(geometryPath);
-        std::stringstream vShaderStream, fShaderStream, gShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        gShaderStream << gShaderFile.rdbuf();
-        vShaderFile.close();
-        fShaderFile.close();
-        gShaderFile.close();
-        vertexCode   = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        geometryCode = gShaderStream.str();
-    }
-    catch(std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+bool Shader::Reload(const std::string &directory) {
+    // a reload that arrives while the previous one is still compiling supersedes it
+    if(pending) {
+        for(auto shader : pendingShaders)
+            glDeleteShader(shader);
+        pendingShaders.clear();
+        pendingTypes.clear();
+        glDeleteProgram(pendingProgram);
+        pending = false;
+    }
+    submitTime = std::chrono::steady_clock::now();
+    return load(directory);
+}
+
+bool Shader::UsesFile(const std::string &name) const {
+    return std::any_of(dependencies.begin(), dependencies.end(), [&](const std::string &path){ return fileName(path) == name; });
+}
+
+void Shader::build(const std::vector<ShaderStage> &stages) {
+    ProgramCache &cache = ProgramCache::Instance();
+    std::vector<std::string> sources;
+    pendingSpirv = false;
+    for(auto &stage : stages) {
+        sources.push_back(std::string(stageName(stage.type)) + (stage.binary ? " spirv\n" : "\n") + stage.source);
+        pendingSpirv |= stage.binary != nullptr;
+    }
+    cacheKey = cache.Key(sources);
+
+    pendingProgram = glCreateProgram();
+    if(cache.Load(cacheKey, pendingProgram)) {
+        swap();
         return;
     }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    const char* gShaderCode = geometryCode.c_str();
+    // no status queries here: asking for GL_COMPILE_STATUS would force the driver to finish right away
+    for(auto &stage : stages) {
+        unsigned int shader = glCreateShader(stage.type);
+        if(stage.binary) {
+            glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, stage.binary, static_cast<GLsizei>(stage.binarySize));
+            glSpecializeShaderARB(shader, "main", static_cast<GLuint>(stage.specIndices.size()), stage.specIndices.data(), stage.specValues.data());
+        } else {
+            const char *code = stage.source.c_str();
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+        }
+        glAttachShader(pendingProgram, shader);
+        pendingShaders.push_back(shader);
+        pendingTypes.push_back(stage.type);
+    }
 
-    unsigned int vxShader, fgShader, gShader;
-    vxShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vxShader, 1, &vShaderCode, NULL);
-    glCompileShader(vxShader);
+    glProgramParameteri(pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(pendingProgram);
+    pending = true;
+}
 
+void Shader::finish() {
     int success;
     char infoLog[512];
-    glGetShaderiv(vxShader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        glGetShaderInfoLog(vxShader, 512, NULL, infoLog);
-        std::cerr << "failed to compile vertex shader:\n " << infoLog << std::endl;
+    for(auto i = 0U; i < pendingShaders.size(); i++) {
+        glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &success);
+        if(!success) {
+            glGetShaderInfoLog(pendingShaders[i], 512, NULL, infoLog);
+            std::cerr << "failed to compile " << stageName(pendingTypes[i]) << " shader:\n" << infoLog << std::endl;
+        }
     }
 
-    fgShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fgShader, 1, &fShaderCode, NULL);
-    glCompileShader(fgShader);
-    glGetShaderiv(fgShader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        glGetShaderInfoLog(fgShader, 512, NULL, infoLog);
-        std::cerr << "failed to compile fragment shader:\n" << infoLog << std::endl;
-    }
+    for(auto shader : pendingShaders)
+        glDeleteShader(shader);
+    pendingShaders.clear();
+    pendingTypes.clear();
+    pending = false;
 
-    gShader = glCreateShader(GL_GEOMETRY_SHADER);
-    glShaderSource(gShader, 1, &gShaderCode, NULL);
-    glCompileShader(gShader);
-    glGetShaderiv(gShader, GL_COMPILE_STATUS, &success);
+    glGetProgramiv(pendingProgram, GL_LINK_STATUS, &success);
     if(!success) {
-        glGetShaderInfoLog(gShader, 512, NULL, infoLog);
-        std::cerr << "failed to compile geometry shader:\n" << infoLog << std::endl;
+        glGetProgramInfoLog(pendingProgram, 512, NULL, infoLog);
+        std::cerr << "failed to compile shader program:\n " << infoLog << std::endl;
+        if(ID || shared)
+            std::cerr << "keeping the previous program live" << std::endl;
+        glDeleteProgram(pendingProgram);
+        pendingProgram = 0;
+        return;
     }
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vxShader);
-    glAttachShader(ID, fgShader);
-    glAttachShader(ID, gShader);
-    glLinkProgram(ID);
+    ProgramCache::Instance().Store(cacheKey, pendingProgram);
+    swap();
+}
 
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if(!success) {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
-        std::cerr << "failed to compile shader program:\n " << infoLog << std::endl;
+void Shader::swap() {
+    if(ID) {
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitTime).count();
+        std::cout << "reloaded " << fileName(desc.compute.empty() ? desc.vertex : desc.compute) << " in " << elapsed << " ms" << std::endl;
+        glDeleteProgram(ID);
     }
+    ID = pendingProgram;
+    spirv = pendingSpirv;
+    pendingProgram = 0;
+    // a variant that split off a shared program has its own from here on
+    shared = nullptr;
+}
+
+bool Shader::IsReady() const {
+    if(!pending)
+        return true;
+    if(!GLAD_GL_KHR_parallel_shader_compile && !GLAD_GL_ARB_parallel_shader_compile)
+        return true;
+    int done = GL_FALSE;
+    glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+bool Shader::Poll() {
+    if(pending && IsReady())
+        finish();
+    if(!ID && shared)
+        return shared->Poll();
+    return ID != 0;
+}
+
+// Flat grey stand-in bound until the first version of a program has linked. It takes the
+// instance matrix when one is bound to location 3 and the model uniform otherwise. INDEXED_INSTANCE
+// draws feed location 3 a uint index instead, so callers skip those until Poll() returns true.
+static unsigned int placeholderProgram() {
+    static unsigned int placeholder = 0;
+    if(placeholder)
+        return placeholder;
+
+    const char *vertexCode =
+        "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "layout (location = 3) in mat4 instanceMatrix;\n"
+        "uniform mat4 projection;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 model;\n"
+        "void main() {\n"
+        "    mat4 world = length(instanceMatrix[0].xyz) > 0.0 ? instanceMatrix : model;\n"
+        "    gl_Position = projection * view * world * vec4(aPos, 1.0);\n"
+        "}\n";
+    const char *fragmentCode =
+        "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main() { FragColor = vec4(0.5, 0.5, 0.5, 1.0); }\n";
 
+    unsigned int vxShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vxShader, 1, &vertexCode, NULL);
+    glCompileShader(vxShader);
+    unsigned int fgShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fgShader, 1, &fragmentCode, NULL);
+    glCompileShader(fgShader);
+
+    placeholder = glCreateProgram();
+    glAttachShader(placeholder, vxShader);
+    glAttachShader(placeholder, fgShader);
+    glLinkProgram(placeholder);
     glDeleteShader(vxShader);
     glDeleteShader(fgShader);
-    glDeleteShader(gShader);
+    return placeholder;
+}
+
+unsigned int Shader::program() const {
+    if(!ID && shared)
+        return shared->program();
+    return ID ? ID : placeholderProgram();
+}
+
+int Shader::location(const std::string &name) const {
+    int uniform = glGetUniformLocation(program(), name.c_str());
+    bool spirvProgram = !ID && shared ? shared->spirv : spirv;
+    if(uniform != -1 || !spirvProgram)
+        return uniform;
+    for(auto file = shader_reflection::uniformLocations; file->file; file++) {
+        if(!UsesFile(file->file))
+            continue;
+        for(auto i = 0U; i < file->count; i++)
+            if(name == file->uniforms[i].name)
+                return file->uniforms[i].location;
+    }
+    return -1;
+}
+
+ShaderLibrary::ShaderLibrary() {
+    Shader::EnableParallelCompile();
+}
+
+Shader &ShaderLibrary::Get(ShaderProgramDesc desc) {
+    std::sort(desc.defines.begin(), desc.defines.end());
+    desc.defines.erase(std::unique(desc.defines.begin(), desc.defines.end()), desc.defines.end());
+
+    std::string key = desc.vertex + '|' + desc.geometry + '|' + desc.fragment + '|' + desc.compute;
+    for(auto &define : desc.defines)
+        key += '|' + define;
+    auto variant = variants.find(key);
+    if(variant != variants.end())
+        return *variant->second;
+
+    std::vector<ShaderStage> stages;
+    std::vector<std::string> dependencies;
+    if(!desc.Preprocess("", stages, dependencies)) {
+        // nothing to compare, so a broken variant gets a program of its own for the watcher to reload once fixed
+        std::cerr << "shader variant " << key << " failed to preprocess" << std::endl;
+        shaders.push_back(std::make_unique<Shader>(std::move(desc), stages, std::move(dependencies)));
+        variants.emplace(key, shaders.back().get());
+        return *shaders.back();
+    }
+
+    // defines that no stage looks at produce the same text, and those variants share a program; a reload
+    // may have changed the text of the program recorded for this hash since
+    uint64_t hash = Shader::HashSources(stages);
+    auto program = programs.find(hash);
+    if(program != programs.end() && program->second->SourceHash() == hash && !program->second->SharesProgram()) {
+        shaders.push_back(std::make_unique<Shader>(std::move(desc), *program->second, std::move(dependencies)));
+    } else {
+        shaders.push_back(std::make_unique<Shader>(std::move(desc), stages, std::move(dependencies)));
+        programs[hash] = shaders.back().get();
+    }
+    variants.emplace(key, shaders.back().get());
+    return *shaders.back();
+}
+
+size_t ShaderLibrary::ProgramCount() const {
+    return std::count_if(shaders.begin(), shaders.end(), [](const std::unique_ptr<Shader> &shader){ return !shader->SharesProgram(); });
+}
+
+Shader &ShaderLibrary::Get(const std::string &vertexPath, const std::string &fragmentPath, std::vector<std::string> defines) {
+    return Get(ShaderProgramDesc{vertexPath, "", fragmentPath, std::move(defines)});
+}
+
+Shader &ShaderLibrary::GetCompute(const std::string &computePath, std::vector<std::string> defines) {
+    return Get(ShaderProgramDesc{"", "", "", std::move(defines), computePath});
+}
+
+size_t ShaderLibrary::Poll() {
+    size_t compiling = 0;
+    for(auto &shader : shaders) {
+        shader->Poll();
+        compiling += shader->IsPending();
+    }
+    return compiling;
 }
 
 void Shader::Use() {
-    glUseProgram(ID);
+    Poll();
+    glUseProgram(program());
 }
 
 void Shader::SetBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), int(value));
+    glUniform1i(location(name), int(value));
 }
 
 void Shader::SetInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(location(name), value);
+}
+
+void Shader::SetUInt(const std::string &name, unsigned int value) const {
+    glUniform1ui(location(name), value);
 }
 
 void Shader::SetFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(location(name), value);
 }
 
 
 void Shader::SetMat4(const std::string &name, glm::mat4 value) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::SetMat4Array(const std::string &name, const glm::mat4 *values, int count) const {
+    glUniformMatrix4fv(location(name), count, GL_FALSE, glm::value_ptr(values[0]));
+}
+
+void Shader::SetVec2(const std::string &name, glm::vec2 value) const {
+    glUniform2fv(location(name), 1, glm::value_ptr(value));
 }
 
+void Shader::SetIVec2(const std::string &name, glm::ivec2 value) const {
+    glUniform2iv(location(name), 1, glm::value_ptr(value));
+}
 
 void Shader::SetVec3(const std::string &name, glm::vec3 value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    glUniform3fv(location(name), 1, glm::value_ptr(value));
 }
 
 unsigned int Shader::GetId() const {
-    return ID;
+    return !ID && shared ? shared->GetId() : ID;
 }
 
 void Shader::SetVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(glm::vec3(x, y, z)));
+    glUniform3fv(location(name), 1, glm::value_ptr(glm::vec3(x, y, z)));
+}
+
+void Shader::SetVec4(const std::string &name, glm::vec4 value) const {
+    glUniform4fv(location(name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetUVec3(const std::string &name, glm::uvec3 value) const {
+    glUniform3uiv(location(name), 1, glm::value_ptr(value));
 }
@@ -0,0 +1,172 @@
+#include "shaderpreprocessor.h"
+#include "shaders_embedded.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const int MAX_INCLUDE_DEPTH = 16;
+
+std::string sourceOverride;
+
+std::string fileNameOf(const std::string &path) {
+    auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+bool readFile(const std::string &path, std::string &source) {
+    std::ifstream file(path);
+    if(!file)
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    source = stream.str();
+    return true;
+}
+
+// the development override directory when one is set and holds the file, else the embedded copy by file
+// name, so a binary whose source tree has moved still runs on the shaders it was built with
+bool readShaderSource(const std::string &path, std::string &source) {
+    std::string name = fileNameOf(path);
+    if(!sourceOverride.empty() && readFile(sourceOverride + '/' + name, source))
+        return true;
+    for(auto &file : embedded_shaders::files) {
+        if(name == file.name) {
+            source.assign(file.source, file.size);
+            return true;
+        }
+    }
+    return sourceOverride.empty() && readFile(path, source);
+}
+
+std::string directoryOf(const std::string &path) {
+    auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// returns the include target if the line is an #include directive
+bool parseInclude(const std::string &line, std::string &target) {
+    auto hash = line.find_first_not_of(" \t");
+    if(hash == std::string::npos || line[hash] != '#')
+        return false;
+    auto keyword = line.find_first_not_of(" \t", hash + 1);
+    if(keyword == std::string::npos || line.compare(keyword, 7, "include") != 0)
+        return false;
+
+    auto open = line.find_first_of("\"<", keyword + 7);
+    if(open == std::string::npos)
+        return false;
+    auto close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if(close == std::string::npos)
+        return false;
+    target = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+bool isVersion(const std::string &line) {
+    auto hash = line.find_first_not_of(" \t");
+    if(hash == std::string::npos || line[hash] != '#')
+        return false;
+    auto keyword = line.find_first_not_of(" \t", hash + 1);
+    return keyword != std::string::npos && line.compare(keyword, 7, "version") == 0;
+}
+
+// true if name occurs in source as a whole identifier
+bool mentions(const std::string &source, const std::string &name) {
+    auto isIdentifier = [](char c){ return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    for(auto pos = source.find(name); pos != std::string::npos; pos = source.find(name, pos + 1)) {
+        bool startOk = pos == 0 || !isIdentifier(source[pos - 1]);
+        bool endOk = pos + name.size() >= source.size() || !isIdentifier(source[pos + name.size()]);
+        if(startOk && endOk)
+            return true;
+    }
+    return false;
+}
+
+bool processFile(const std::string &path, std::string &output, size_t &versionEnd,
+                 std::vector<std::string> &dependencies, std::vector<std::string> &stack) {
+    if(std::find(stack.begin(), stack.end(), path) != stack.end() || stack.size() >= MAX_INCLUDE_DEPTH) {
+        std::cerr << "shader include cycle at " << path << std::endl;
+        return false;
+    }
+    // include guard: every file is pasted once per stage
+    if(!stack.empty() && std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end())
+        return true;
+
+    std::string source;
+    if(!readShaderSource(path, source)) {
+        std::cerr << "failed to read shader file: " << path << std::endl;
+        return false;
+    }
+    std::istringstream file(source);
+
+    auto sourceIndex = dependencies.size();
+    dependencies.push_back(path);
+    stack.push_back(path);
+    if(stack.size() > 1)
+        output += "#line 1 " + std::to_string(sourceIndex) + "\n";
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line)) {
+        lineNumber++;
+        std::string target;
+        if(parseInclude(line, target)) {
+            if(!processFile(directoryOf(path) + target, output, versionEnd, dependencies, stack))
+                return false;
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+        } else if(stack.size() == 1 && isVersion(line)) {
+            output += line + "\n";
+            versionEnd = output.size();
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+        } else {
+            output += line + "\n";
+        }
+    }
+
+    stack.pop_back();
+    return true;
+}
+
+}
+
+void SetShaderSourceOverride(const std::string &directory) {
+    sourceOverride = directory;
+}
+
+const std::string &ShaderSourceOverride() {
+    return sourceOverride;
+}
+
+bool PreprocessShader(const std::string &path, const std::vector<std::string> &defines, std::string &output,
+                      std::vector<std::string> &dependencies, std::vector<std::string> *applied) {
+    output.clear();
+    dependencies.clear();
+    if(applied)
+        applied->clear();
+    std::vector<std::string> stack;
+    size_t versionEnd = 0;
+    if(!processFile(path, output, versionEnd, dependencies, stack))
+        return false;
+
+    // only inject defines the stage actually tests, so permutations that cannot differ produce identical text
+    std::string injected;
+    for(auto &define : defines) {
+        auto equals = define.find('=');
+        std::string name = define.substr(0, equals);
+        if(!mentions(output, name))
+            continue;
+        if(applied)
+            applied->push_back(define);
+        if(equals == std::string::npos)
+            injected += "#define " + define + "\n";
+        else
+            injected += "#define " + name + " " + define.substr(equals + 1) + "\n";
+    }
+    output.insert(versionEnd, injected);
+    return true;
+}
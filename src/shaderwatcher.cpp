@@ -0,0 +1,89 @@
+#include "shaderwatcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+ShaderWatcher::ShaderWatcher(const std::string &directory) : directory(directory) {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd < 0) {
+        std::cerr << "failed to init inotify, shader hot reload disabled" << std::endl;
+        return;
+    }
+    // editors either rewrite the file in place or write a temporary and rename it over the original
+    if(inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "failed to watch " << directory << ", shader hot reload disabled" << std::endl;
+        close(fd);
+        fd = -1;
+        return;
+    }
+
+    running = true;
+    thread = std::thread(&ShaderWatcher::run, this);
+    std::cout << "watching " << directory << " for shader changes" << std::endl;
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    running = false;
+    if(thread.joinable())
+        thread.join();
+    if(fd >= 0)
+        close(fd);
+}
+
+void ShaderWatcher::run() {
+    alignas(inotify_event) char buffer[4096];
+    pollfd descriptor{fd, POLLIN, 0};
+    while(running) {
+        // short timeout so the destructor never waits long for the thread to notice
+        if(poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t length;
+        while((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for(char *p = buffer; p < buffer + length; ) {
+                auto *event = reinterpret_cast<inotify_event *>(p);
+                if(event->len > 0) {
+                    std::string name(event->name);
+                    if(std::find(changed.begin(), changed.end(), name) == changed.end())
+                        changed.push_back(name);
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+void ShaderWatcher::Watch(Shader &shader) {
+    shaders.push_back(&shader);
+}
+
+void ShaderWatcher::Watch(ShaderLibrary &library) {
+    libraries.push_back(&library);
+}
+
+size_t ShaderWatcher::Update() {
+    std::vector<std::string> files;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        files.swap(changed);
+    }
+    if(files.empty())
+        return 0;
+
+    size_t reloaded = 0;
+    auto reload = [&](Shader &shader){
+        bool affected = std::any_of(files.begin(), files.end(), [&](const std::string &file){ return shader.UsesFile(file); });
+        if(affected && shader.Reload(directory))
+            reloaded++;
+    };
+    for(auto *shader : shaders)
+        reload(*shader);
+    for(auto *library : libraries)
+        for(auto &shader : library->Programs())
+            reload(*shader);
+    return reloaded;
+}
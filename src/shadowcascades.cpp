@@ -0,0 +1,157 @@
+#include "shadowcascades.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace shadows = shader_reflection::shadows;
+
+namespace {
+
+// binding of shadowMap in shadows.glsl, clear of the units Mesh::Draw hands out
+const unsigned int SHADOW_MAP_UNIT = 4;
+
+}
+
+CascadedShadows::CascadedShadows(ShadowParams params) : params(params) {
+}
+
+glm::mat4 CascadedShadows::fit(const glm::vec3 &center, float radius, const glm::vec3 &sunDirection, float &texelSize) const {
+    glm::vec3 up = std::fabs(sunDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), sunDirection, up);
+    // rounding the radius up keeps the texel size, and with it the snapping grid, fixed while it changes slightly
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    texelSize = 2.0f * radius / SHADOW_MAP_RESOLUTION;
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+    // the light looks down -z, so casters between the sun and the sphere sit at larger z
+    glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+                                      -(lightCenter.z + radius + params.casterDistance), -(lightCenter.z - radius));
+    return projection * lightView;
+}
+
+void CascadedShadows::Plan(const glm::mat4 &view, float fovY, float aspect, float nearPlane, const glm::vec3 &sunDirection, ShadowFrame &out) {
+    out.sunDirection = glm::normalize(sunDirection);
+    glm::mat4 inverseView = glm::inverse(view);
+    glm::vec3 eye = glm::vec3(inverseView[3]);
+    glm::vec3 forward = -glm::normalize(glm::vec3(inverseView[2]));
+    // slope from the view axis to a frustum corner
+    float corner = std::sqrt(1.0f + aspect * aspect) * std::tan(fovY * 0.5f);
+    bool sunMoved = !cacheValid || glm::dot(out.sunDirection, cachedSun) < params.sunThreshold;
+
+    float sliceNear = nearPlane;
+    for(auto i = 0U; i < SHADOW_CASCADES; i++) {
+        // practical split scheme (Zhang et al. 2006): a blend of logarithmic and uniform placement
+        float t = float(i + 1) / SHADOW_CASCADES;
+        float logarithmic = nearPlane * std::pow(params.distance / nearPlane, t);
+        float uniform = nearPlane + (params.distance - nearPlane) * t;
+        float sliceFar = params.splitLambda * logarithmic + (1.0f - params.splitLambda) * uniform;
+
+        // smallest sphere through the near and far corners of the slice, centred on the view axis
+        float centerDepth = std::min((sliceFar + sliceNear) * (1.0f + corner * corner) * 0.5f, sliceFar);
+        float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + sliceFar * corner * sliceFar * corner);
+        glm::vec3 center = eye + forward * centerDepth;
+
+        ShadowCascade &cascade = out.cascades[i];
+        if(!params.cacheFarCascades || i < FIRST_CACHED) {
+            cascade.viewProjection = fit(center, radius, out.sunDirection, cascade.texelSize);
+            cascade.dirty = true;
+        } else {
+            glm::vec4 &sphere = cachedSphere[i];
+            bool contained = glm::length(center - glm::vec3(sphere)) + radius <= sphere.w;
+            cached[i].dirty = sunMoved || !contained;
+            if(cached[i].dirty) {
+                sphere = glm::vec4(center, radius * (1.0f + params.cacheMargin));
+                cached[i].viewProjection = fit(center, sphere.w, out.sunDirection, cached[i].texelSize);
+            }
+            cascade = cached[i];
+        }
+        cascade.splitDepth = sliceFar;
+        sliceNear = sliceFar;
+    }
+
+    cacheValid = params.cacheFarCascades;
+    if(sunMoved)
+        cachedSun = out.sunDirection;
+}
+
+void CascadedShadows::Disable(const glm::vec3 &sunDirection, ShadowFrame &out) {
+    out.sunDirection = glm::normalize(sunDirection);
+    for(auto &cascade : out.cascades) {
+        cascade.splitDepth = 0.0f;
+        cascade.dirty = false;
+    }
+    cacheValid = false;
+}
+
+void ShadowMapArray::create() {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, SHADOW_CASCADES);
+    // linear filtering with compare mode gives 2x2 PCF per lookup
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // lookups past the edge of a cascade read as lit
+    float border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    // an untouched layer compares as fully lit
+    float clear = 1.0f;
+    glClearTexImage(texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &clear);
+
+    glGenFramebuffers(1, &framebuffer);
+}
+
+void ShadowMapArray::Begin(unsigned int cascade) {
+    if(!active) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        if(!framebuffer)
+            create();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glViewport(0, 0, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
+        // slope-scaled bias for the surfaces facing the sun; the normal offset in the lookup covers the rest
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.5f, 4.0f);
+        active = true;
+    }
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMapArray::End() {
+    if(!active)
+        return;
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    active = false;
+}
+
+void ShadowMapArray::Apply(Shader &forward, const ShadowFrame &frame) {
+    if(!texture)
+        create();
+    glm::mat4 matrices[SHADOW_CASCADES];
+    glm::vec4 splits, texelSizes;
+    for(auto i = 0U; i < SHADOW_CASCADES; i++) {
+        matrices[i] = frame.cascades[i].viewProjection;
+        splits[i] = frame.cascades[i].splitDepth;
+        texelSizes[i] = frame.cascades[i].texelSize;
+    }
+    forward.SetMat4Array(shadows::uniform::cascadeViewProjection, matrices, SHADOW_CASCADES);
+    forward.SetVec4(shadows::uniform::cascadeSplits, splits);
+    forward.SetVec4(shadows::uniform::cascadeTexelSizes, texelSizes);
+    forward.SetVec3(shadows::uniform::sunDirection, frame.sunDirection);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,302 @@
+#include "skybox.h"
+#include "shader.h"
+#include "shader_reflection.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace skyboxVs = shader_reflection::skyboxVertex;
+
+const char *const Skybox::FACES[6] = {"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
+
+namespace {
+
+const uint32_t COOKED_MAGIC = 0x42594B53; // "SKYB"
+const GLenum COOKED_FORMAT = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+struct CookedHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    int32_t size;
+    int32_t levels;
+};
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for(auto i = 0U; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+int mipLevels(int size) {
+    int levels = 1;
+    while(size > 1) {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+}
+
+Skybox::~Skybox() {
+    // decode jobs write into images
+    JobSystem::Instance().Wait(loading);
+    releaseImages();
+}
+
+uint64_t Skybox::sourceKey() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(auto face : FACES) {
+        std::error_code error;
+        std::filesystem::path path = directory + "/" + face;
+        uint64_t fileSize = std::filesystem::file_size(path, error);
+        if(error)
+            return 0;
+        auto modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        if(error)
+            return 0;
+        hash = fnv1a(hash, face, std::char_traits<char>::length(face));
+        hash = fnv1a(hash, &fileSize, sizeof(fileSize));
+        hash = fnv1a(hash, &modified, sizeof(modified));
+    }
+    return hash;
+}
+
+void Skybox::Load(const std::string &directory, const std::string &cookedPath) {
+    this->directory = directory;
+    this->cookedPath = cookedPath;
+    fromCooked = false;
+    if(!cookedPath.empty()) {
+        // the header is tiny, so whether the cooked file is current is settled here
+        std::ifstream file(cookedPath, std::ios::binary);
+        CookedHeader header{};
+        uint64_t key = sourceKey();
+        fromCooked = file && file.read(reinterpret_cast<char *>(&header), sizeof(header)) && header.magic == COOKED_MAGIC &&
+                     header.format == COOKED_FORMAT && key != 0 && header.key == key && header.size > 0 && header.levels == mipLevels(header.size);
+        if(fromCooked) {
+            size = header.size;
+            levels = header.levels;
+        }
+    }
+
+    JobSystem &jobs = JobSystem::Instance();
+    if(fromCooked) {
+        images.assign(levels * 6, Image());
+        jobs.Run([this] {
+            if(!readCooked()) {
+                fromCooked = false;
+                images.clear();
+            }
+        }, &loading);
+    } else {
+        images.assign(6, Image());
+        for(auto face = 0U; face < 6; face++)
+            jobs.Run([this, face] { decodeFace(face); }, &loading);
+    }
+}
+
+bool Skybox::readCooked() {
+    std::ifstream file(cookedPath, std::ios::binary);
+    file.seekg(sizeof(CookedHeader));
+    for(auto &image : images) {
+        uint64_t length = 0;
+        if(!file.read(reinterpret_cast<char *>(&length), sizeof(length)) || length > 64ull * 1024 * 1024)
+            return false;
+        image.blocks.resize(length);
+        if(!file.read(reinterpret_cast<char *>(image.blocks.data()), length))
+            return false;
+    }
+    for(auto level = 0; level < levels; level++)
+        for(auto face = 0; face < 6; face++)
+            images[level * 6 + face].size = std::max(size >> level, 1);
+    return true;
+}
+
+void Skybox::decodeFace(unsigned int face) {
+    std::string path = directory + "/" + FACES[face];
+    int width, height, components;
+    Image &image = images[face];
+    image.pixels = stbi_load(path.c_str(), &width, &height, &components, 3);
+    if(image.pixels && width != height) {
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+    }
+    image.size = image.pixels ? width : 0;
+}
+
+void Skybox::releaseImages() {
+    for(auto &image : images)
+        if(image.pixels)
+            stbi_image_free(image.pixels);
+    images.clear();
+}
+
+bool Skybox::Finish() {
+    JobSystem &jobs = JobSystem::Instance();
+    jobs.Wait(loading);
+    if(!fromCooked && images.empty()) {
+        // the cooked file went bad after its header was checked; decode the faces after all
+        std::cerr << "skybox: cooked file " << cookedPath << " is truncated, decoding the faces" << std::endl;
+        releaseImages();
+        images.assign(6, Image());
+        for(auto face = 0U; face < 6; face++)
+            jobs.Run([this, face] { decodeFace(face); }, &loading);
+        jobs.Wait(loading);
+    }
+
+    if(fromCooked) {
+        createCompressed();
+    } else {
+        size = images[0].size;
+        for(auto face = 0U; face < 6; face++) {
+            if(images[face].size == 0 || images[face].size != size) {
+                std::cerr << "skybox: failed to load a square " << size << " px face from " << directory << "/" << FACES[face] << std::endl;
+                releaseImages();
+                return false;
+            }
+        }
+        levels = mipLevels(size);
+        createUncompressed();
+        if(!cookedPath.empty()) {
+            if(GLAD_GL_EXT_texture_compression_s3tc)
+                cook();
+            else
+                std::cout << "skybox: no S3TC support, the sky stays uncompressed" << std::endl;
+        }
+    }
+    releaseImages();
+
+    // faces sample across their edges, so the seams between them do not show at lower mips
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    float vertices[] = {
+        -1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+        -1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,
+    };
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    glBindVertexArray(cubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(skyboxVs::attrib::aPos);
+    glVertexAttribPointer(skyboxVs::attrib::aPos, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    glBindVertexArray(0);
+    return true;
+}
+
+void Skybox::createUncompressed() {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGB8, size, size);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(auto face = 0U; face < 6; face++)
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, size, size, GL_RGB, GL_UNSIGNED_BYTE, images[face].pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    compressed = false;
+}
+
+void Skybox::createCompressed() {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, COOKED_FORMAT, size, size);
+    for(auto level = 0; level < levels; level++) {
+        for(auto face = 0; face < 6; face++) {
+            const Image &image = images[level * 6 + face];
+            glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, image.size, image.size, COOKED_FORMAT,
+                                      static_cast<GLsizei>(image.blocks.size()), image.blocks.data());
+        }
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    compressed = true;
+}
+
+// Reads every level of the uncompressed cubemap back, has the driver compress it through a scratch texture,
+// swaps the cubemap for a compressed one and writes the blocks to cookedPath
+void Skybox::cook() {
+    std::vector<Image> blocks(levels * 6);
+    std::vector<unsigned char> pixels(size_t(size) * size * 3);
+    unsigned int scratch;
+    glGenTextures(1, &scratch);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(auto level = 0; level < levels; level++) {
+        int levelSize = std::max(size >> level, 1);
+        for(auto face = 0; face < 6; face++) {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            glBindTexture(GL_TEXTURE_2D, scratch);
+            glTexImage2D(GL_TEXTURE_2D, 0, COOKED_FORMAT, levelSize, levelSize, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            GLint length = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &length);
+            Image &image = blocks[level * 6 + face];
+            image.size = levelSize;
+            image.blocks.resize(length);
+            glGetCompressedTexImage(GL_TEXTURE_2D, 0, image.blocks.data());
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &scratch);
+    glDeleteTextures(1, &texture);
+
+    releaseImages();
+    images = std::move(blocks);
+    createCompressed();
+    writeCooked();
+}
+
+void Skybox::writeCooked() const {
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(cookedPath).parent_path();
+    if(!parent.empty())
+        std::filesystem::create_directories(parent, error);
+    std::ofstream file(cookedPath, std::ios::binary);
+    CookedHeader header{COOKED_MAGIC, COOKED_FORMAT, sourceKey(), size, levels};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for(auto &image : images) {
+        uint64_t length = image.blocks.size();
+        file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        file.write(reinterpret_cast<const char *>(image.blocks.data()), length);
+    }
+    if(!file)
+        std::cerr << "skybox: failed to write " << cookedPath << std::endl;
+}
+
+void Skybox::Draw(Shader &skyboxShader, const glm::mat4 &projection, const glm::mat4 &view) {
+    if(!texture || !skyboxShader.Poll())
+        return;
+    // the vertex shader puts the sky at the far plane, so only pixels nothing was drawn to pass the depth
+    // test and the rest are rejected before shading; nothing behind the sky needs its depth
+    glDepthMask(GL_FALSE);
+    skyboxShader.Use();
+    skyboxShader.SetMat4(skyboxVs::uniform::projection, projection);
+    skyboxShader.SetMat4(skyboxVs::uniform::view, view);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glBindVertexArray(cubeVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+}